@@ -2,6 +2,7 @@
 #define COMMON_INCLUDES
 
 #include <X11/Xlib.h>
+#include <X11/Xlib-xcb.h>
 #include <X11/extensions/Xcomposite.h>
 #include <X11/extensions/Xfixes.h>
 #include <X11/extensions/shape.h>
@@ -19,6 +20,7 @@
 #include <dlfcn.h>
 #include <unistd.h>
 #include <cstdlib>
+#include <climits>
 #include <sys/ipc.h>
 #include <sys/shm.h>
 #include <memory>
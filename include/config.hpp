@@ -8,6 +8,10 @@ class Config {
     struct Option {
         InternalOptionType type;
         std::string value;
+
+        bool operator == (const Option &other) const {
+            return type == other.type && value == other.value;
+        }
     };
 
     private:
@@ -18,7 +22,10 @@ class Config {
         std::string  path;
         bool blocked = false;
 
-        void readConfig();
+        int inotifyFd = -1;
+
+        /* returns false if the file can't be read or has garbage */
+        bool readConfig();
         void setValue(Data *data, std::string val);
 
     public:
@@ -26,6 +33,19 @@ class Config {
         Config();
         void setOptionsForPlugin(PluginPtr plugin);
         void reset();
+
+        /* read the file again, changed gets the names of the
+         * sections(plugins) whose options have changed. If the
+         * file can't be read or parsed, the current options are
+         * kept and false is returned */
+        bool reload(std::unordered_set<std::string> &changed);
+
+        /* returns a fd which is readable when the
+         * directory of the config file changes */
+        int startWatching();
+        /* reads the pending events from that fd,
+         * returns true if the config file was written */
+        bool checkChanged();
 };
 
 extern Config *config;
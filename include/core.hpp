@@ -5,6 +5,9 @@
 #include "window.hpp"
 #include "glx.hpp"
 #include "config.hpp"
+#include "timer.hpp"
+#include "resource.hpp"
+#include "viewport.hpp"
 
 class WinStack;
 
@@ -26,6 +29,8 @@ struct Binding{
     uint mod;
     uint id;
     std::function<void(Context*)> action;
+    Ownership owner; // set by Core, see OwnerScope
+    uint64_t tableKey; // set by Core, key in its binding table
 };
 
 struct KeyBinding : Binding {
@@ -33,6 +38,12 @@ struct KeyBinding : Binding {
 
     void enable();
     void disable();
+    /* grab key and mod again if they changed while active */
+    void regrab();
+
+    private:
+        KeyCode grabbedKey;
+        uint grabbedMod;
 };
 
 struct ButtonBinding : Binding {
@@ -40,6 +51,12 @@ struct ButtonBinding : Binding {
 
     void enable();
     void disable();
+    /* grab button and mod again if they changed while active */
+    void regrab();
+
+    private:
+        uint grabbedButton;
+        uint grabbedMod;
 };
 
 // hooks are done once a redraw cycle
@@ -49,6 +66,7 @@ struct Hook {
     public:
         uint id;
         std::function<void(void)> action;
+        Ownership owner; // set by Core, see OwnerScope
 
         virtual void enable();
         virtual void disable();
@@ -73,11 +91,54 @@ struct EffectHook : public Hook {
     FireWindow win;
 };
 
-using SignalListenerData = std::vector<void*>;
+/* payload of a signal, listeners cast it to
+ * the type documented for the signal */
+struct SignalData {};
+
+/* map-window, unmap-window */
+struct MapWindowSignal : public SignalData {
+    FireWindow win;
+    MapWindowSignal(FireWindow win) : win(win) {}
+};
+
+/* move-window, dx and dy are relative to the old position */
+struct MoveWindowSignal : public SignalData {
+    FireWin *win;
+    int dx, dy;
+    MoveWindowSignal(FireWin *win, int dx, int dy) : win(win), dx(dx), dy(dy) {}
+};
+
+/* screen-scale-changed, triggered by expo */
+struct ScaleChangedSignal : public SignalData {
+    int scX, scY;
+    ScaleChangedSignal(int scX, int scY) : scX(scX), scY(scY) {}
+};
+
+using SignalID = uint;
 
 struct SignalListener {
-    std::function<void(SignalListenerData)> action;
+    std::function<void(SignalData&)> action;
     uint id;
+    Ownership owner; // set by Core, see OwnerScope
+};
+
+struct Signal {
+    std::vector<SignalListener*> listeners;
+    /* listeners removed while the signal is being triggered
+     * are set to nullptr and erased after the dispatch */
+    int dispatching = 0;
+    bool dirty = false;
+};
+
+/* everything registered (bindings, hooks, effects, listeners,
+ * timers, renderer) while an OwnerScope exists is owned by owner,
+ * so that it can be removed when the plugin is unloaded.
+ * Core opens a scope when it initializes a plugin and when it
+ * runs a callback, so plugins normally do not need this */
+struct OwnerScope {
+    Ownership previous;
+    OwnerScope(Ownership owner);
+    ~OwnerScope();
 };
 
 #define GetTuple(x,y,t) auto x = std::get<0>(t); \
@@ -86,10 +147,13 @@ class Core {
 
     // used to optimize idle time by counting hooks(cntHooks)
     friend struct Hook;
+    friend struct OwnerScope;
 
     private:
         WinStack *wins;
         pollfd fd;
+        pollfd configFd;
+        uint configTimer = -1;
         int cntHooks;
         int damage;
         Window s0owner;
@@ -106,16 +170,82 @@ class Core {
         std::vector<PluginPtr> plugins;
         std::vector<KeyBinding*> keys;
         std::vector<ButtonBinding*> buttons;
+
+        /* bindings indexed by (keycode/button, modifier) for dispatch,
+         * bindings for button release are indexed with AnyModifier.
+         * A binding is indexed again when it is added again */
+        template<class T> using BindingTable =
+            std::unordered_map<uint64_t, std::vector<T*>>;
+        BindingTable<KeyBinding> keyTable;
+        BindingTable<ButtonBinding> pressTable, releaseTable;
+
+        template<class T>
+        void indexBinding(BindingTable<T> &table, T *b, uint64_t key);
+        template<class T>
+        void unindexBinding(BindingTable<T> &table, T *b);
+        void indexButton(ButtonBinding *bb);
+        /* run active bindings with the given key until action returns true */
+        template<class T, class F>
+        void dispatchBindings(BindingTable<T> &table, uint64_t key, F action);
         std::vector<Hook*> hooks;
         std::vector<EffectHook*> effects;
         std::unordered_set<Ownership> owners;
 
-        std::unordered_map<std::string,
-            std::vector<SignalListener*>> signals;
+        /* indexed by SignalID, a deque so that adding
+         * a signal during dispatch keeps references valid */
+        std::deque<Signal> signals;
+        std::unordered_map<std::string, SignalID> signalIDs;
         void addDefaultSignals();
-
+        void removeListeners(Signal &sig,
+                std::function<bool(SignalListener*)> pred);
+
+        TimerWheel timers;
+
+        /* owner of registrations made now, see OwnerScope */
+        Ownership currentOwner;
+        std::unordered_map<uint, Ownership> timerOwners;
+        bool slotUsed[MaxDataSlots] = {false};
+        Ownership slotOwners[MaxDataSlots];
+        void removeOwnedBy(Ownership owner);
+
+        /* ranges of request serials whose errors are expected,
+         * ignoreDepth counts nested ignoreErrorsStart() calls */
+        std::deque<std::pair<ulong, ulong>> ignoredErrors;
+        int ignoreDepth = 0;
+
+        /* window info requested in the current event batch,
+         * replies are collected in flushPendingRequests() so
+         * that the whole batch needs a single round trip */
+        struct PendingWindow {
+            XCreateWindowEvent xev;
+            WindowCookies cookies;
+        };
+        struct PendingProperty {
+            Window win;
+            Atom atom;
+            xcb_get_property_cookie_t cookie;
+        };
+        std::vector<PendingWindow> pendingWindows;
+        std::vector<PendingProperty> pendingProperties;
+
+        void flushPendingRequests();
+        void finishMapping(FireWindow win);
+
+        /* startup time, used for measuring startup phases */
+        uint64_t startTime;
+        bool firstFrameDone = false;
+        std::vector<TimerCallback> afterFirstFrame;
+        void onFirstFrame();
+
+        void loadBackgroundImage(std::string path);
+
+        /* whether the state in shared memory is outdated */
+        bool stateDirty = true;
+        void updateProperty(FireWindow w, Atom atom,
+                xcb_get_property_reply_t *reply);
 
         void handleEvent(XEvent xev);
+        void reloadConfig();
         void wait(int timeout);
         void enableInputPass(Window win);
         void addExistingWindows(); // adds windows created before
@@ -124,14 +254,20 @@ class Core {
         void initDefaultPlugins();
         template<class T> PluginPtr createPlugin();
         PluginPtr loadPluginFromFile(std::string path, void **handle);
+        PluginPtr loadDynamicPlugin(std::string name);
         void loadDynamicPlugins();
+        void initPlugin(PluginPtr p);
+        /* load/unload plugins so that they match the plugins option */
+        void updateDynamicPlugins();
 
         void defaultRenderer();
-        void afterEffects();
+        /* see scheduleRedraw() */
+        bool redrawScheduled = false;
 
         struct {
             RenderHook currentRenderer;
             bool replaced = true;
+            Ownership owner;
         } render;
 
     public:
@@ -139,6 +275,7 @@ class Core {
         /* warning!!!
          * no plugin should change these! */
         Display *d;
+        xcb_connection_t *xconn;
         Window root;
         Window outputwin;
         Window overlay;
@@ -155,12 +292,24 @@ class Core {
         static int onXError (Display* d, XErrorEvent* xev);
         static int onOtherWmDetected(Display *d, XErrorEvent *xev);
 
+        /* we do not run synchronously, so errors arrive later.
+         * Errors caused by requests issued between these two calls
+         * are expected (for ex. the window was destroyed meanwhile)
+         * and are ignored, they are matched by request serial.
+         * Calls may be nested, the outermost pair makes the range */
+        void ignoreErrorsStart();
+        void ignoreErrorsEnd();
+
+        /* run the effects, renderers which replace the
+         * default one call this before OpenGL::endStage() */
+        void afterEffects();
+
         void run(const char *command);
         FireWindow findWindow(Window win);
         FireWindow getActiveWindow();
         std::function<FireWindow(int,int)> getWindowAtPoint;
 
-        void addWindow(XCreateWindowEvent);
+        void addWindow(XCreateWindowEvent, WindowCookies&);
         void addWindow(Window);
         void focusWindow(FireWindow win);
         void closeWindow(FireWindow win);
@@ -168,6 +317,14 @@ class Core {
         void mapWindow(FireWindow win, bool xmap = true);
         void unmapWindow(FireWindow win);
         int getRefreshRate();
+        /* see LazyResource */
+        int getGPUIdleTime();
+
+        /* returns a free per-window data slot or -1,
+         * the slot is released when its owner is unloaded */
+        DataSlot allocDataSlot();
+        /* deletes the slot's data of all windows */
+        void freeDataSlot(DataSlot slot);
 
         void setBackground(const char *path);
         bool setRenderer(RenderHook rh);
@@ -185,22 +342,59 @@ class Core {
         void addEffect(EffectHook *);
         void remEffect(uint key, FireWindow win = nullptr);
 
-        void addSignal(std::string name);
+        /* run action once after timeout milliseconds,
+         * returns an id which can be used to remove the timer */
+        uint addTimer(int timeout, TimerCallback action);
+        void remTimer(uint id);
+
+        /* run action once the first frame is on screen,
+         * used for work which is not needed for it
+         * (shader compilation, decoding images, etc.).
+         * After that, action is run immediately */
+        void runAfterFirstFrame(TimerCallback action);
+
+        /* save a snapshot of the state to shared memory,
+         * it is done automatically after each event batch
+         * in which markStateDirty() was called */
+        void saveState();
+        /* something saved by saveState() has changed: the stack,
+         * a window's type, state, links or viewport, the client
+         * list, the active window or the viewport */
+        void markStateDirty() { stateDirty = true; }
+
+        /* load plugin lib<name>.so from pluginpath at runtime,
+         * returns false if it could not be loaded */
+        bool loadPlugin(std::string name);
+        /* fini() the plugin, remove everything it registered
+         * and close the library */
+        void unloadPlugin(std::string name);
+
+        /* signal names are resolved to an id once, the id
+         * should be kept and used for triggering */
+        SignalID addSignal(std::string name);
+        void connectSignal(SignalID sig, SignalListener *callback);
         void connectSignal(std::string name, SignalListener *callback);
+        void disconnectSignal(SignalID sig, uint id);
         void disconnectSignal(std::string name, uint id);
-        void triggerSignal(std::string name, SignalListenerData data);
+        void triggerSignal(SignalID sig, SignalData &data);
+
+        SignalID mapWindowSignal, unmapWindowSignal, moveWindowSignal;
 
         void regOwner(Ownership owner);
-        bool checkKey(KeyBinding *kb, XKeyEvent xkey);
-        bool checkButPress  (ButtonBinding *bb, XButtonEvent xb);
-        bool checkButRelease(ButtonBinding *bb, XButtonEvent xb);
         bool activateOwner  (Ownership owner);
         bool deactivateOwner(Ownership owner);
 
         /* this function renders a viewport and
-         * saves the image in texture which is returned */
+         * saves the image in texture which is returned.
+         * viewportCache is cheaper if the viewport is
+         * needed more than once */
         void getViewportTexture(std::tuple<int, int>, GLuint& fbuff,
                 GLuint& tex);
+        /* render the bounding box of damage (viewport coordinates)
+         * of viewport vp into fbuff, see ViewportCache */
+        void renderViewport(std::tuple<int, int> vp, GLuint fbuff,
+                const FireRegion &damage);
+        ViewportCache *viewportCache;
 
         std::vector<FireWindow> getWindowsOnViewport(std::tuple<int, int>);
         void switchWorkspace(std::tuple<int, int>);
@@ -211,12 +405,20 @@ class Core {
         std::tuple<int, int> getMouseCoord();
 
         bool resetDMG;
-        Region dmg;
-        void damageRegion(Region r);
-        void damageREGION(REGION r);
-        Region getMaximisedRegion();
-        Region getRegionFromRect(int tlx, int tly, int brx, int bry);
-        REGION getREGIONFromRect(int tlx, int tly, int brx, int bry);
+        FireRegion dmg;
+        void damageRegion(const FireRegion &r);
+        /* draw the next frame even if nothing is damaged, for
+         * renderers which don't draw windows (expo, cube...) */
+        void scheduleRedraw();
+
+        /* how often damageRegion() had to merge boxes
+         * or fall back to repainting everything */
+        struct {
+            uint64_t simplified = 0, merges = 0;
+            uint64_t fullDamage = 0;
+        } damageStats;
+        FireRegion getMaximisedRegion();
+        FireRegion getRegionFromRect(int tlx, int tly, int brx, int bry);
         /* use this function to draw all windows
          * but do not forget to turn it off
          * as it is extremely bad for performance */
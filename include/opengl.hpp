@@ -12,6 +12,11 @@ namespace OpenGL {
     void initOpenGL(const char *shaderSrcPath);
     void renderTransformedTexture(GLuint text, GLuint vao,
      GLuint vbo, glm::mat4 t);
+    /* like renderTransformedTexture, but mvp is used as is */
+    void renderTextureMVP(GLuint text, GLuint vao,
+     GLuint vbo, const glm::mat4 &mvp);
+    /* Proj * View, precomputed in initOpenGL */
+    const glm::mat4& getProjView();
     void renderTexture(GLuint text, GLuint vao, GLuint vbo);
 
     void preStage();
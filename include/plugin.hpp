@@ -68,18 +68,17 @@ struct Button {
     int button;
 };
 
-union SubData {
-    bool  bval;
-    int   ival;
-    float fval;
-
-    string *sval;
-    Color  *color;
-    Key    *key;
-    Button *but;
-
-    SubData();
-    ~SubData();
+/* values are stored inline, only the field
+ * corresponding to the option type is used */
+struct SubData {
+    bool   bval = false;
+    int    ival = 0;
+    float  fval = 0;
+
+    string sval;
+    Color  color = {0, 0, 0};
+    Key    key   = {0, 0};
+    Button but   = {0, 0};
 };
 
 struct Data {
@@ -93,6 +92,38 @@ struct Data {
     Data();
 };
 
+/* maps a C++ type to its DataType and field in SubData */
+template<class T> struct OptionType;
+
+#define DefineOptionType(T, dataType, field)              \
+    template<> struct OptionType<T> {                     \
+        static constexpr DataType type = dataType;        \
+        static T& get(SubData &sub) { return sub.field; } \
+    }
+
+DefineOptionType(bool,   DataTypeBool,   bval);
+DefineOptionType(int,    DataTypeInt,    ival);
+DefineOptionType(float,  DataTypeFloat,  fval);
+DefineOptionType(string, DataTypeString, sval);
+DefineOptionType(Color,  DataTypeColor,  color);
+DefineOptionType(Key,    DataTypeKey,    key);
+DefineOptionType(Button, DataTypeButton, but);
+
+/* handle to an option, returned by Plugin::addOption().
+ * It points directly to the option's value, so reading it
+ * costs no lookup. The value is updated by Config before
+ * updateConfiguration() is called */
+template<class T> class Option {
+    Data *data = nullptr;
+
+    public:
+        Option() {}
+        Option(Data *data) : data(data) {}
+
+        const T& operator *  () const { return  OptionType<T>::get(data->data); }
+        const T* operator -> () const { return &OptionType<T>::get(data->data); }
+};
+
 using DataPair = std::pair<string, Data*>;
 /* helper functions to easily add options */
 DataPair newIntOption   (string name, int    defaultVal);
@@ -111,6 +142,25 @@ class Plugin {
     public:
         std::unordered_map<string, Data*> options;
 
+        /* add an option with the given default value,
+         * should be used in init() */
+        template<class T> Option<T> addOption(string name, T defaultVal) {
+            auto data = new Data();
+            data->type = OptionType<T>::type;
+            OptionType<T>::get(data->def)  = defaultVal;
+            OptionType<T>::get(data->data) = defaultVal;
+
+            delete options[name];
+            options[name] = data;
+            return Option<T>(data);
+        }
+
+        Option<string> addOption(string name, const char *defaultVal) {
+            return addOption<string>(name, defaultVal);
+        }
+
+        virtual ~Plugin();
+
         /* initOwnership() should set all values in own */
         virtual void initOwnership();
 
@@ -120,7 +170,9 @@ class Plugin {
          * and if not available, the data becomes def */
         virtual void init() = 0;
 
-        /* used to obtain already read options */
+        /* used to obtain already read options.
+         * It is called again when the config file changes,
+         * adding the same binding/hook/listener again is fine */
         virtual void updateConfiguration();
 
         /* the fini() method should remove all hooks/buttons/keys
@@ -132,6 +184,7 @@ class Plugin {
         /* plugin must not touch these! */
         bool dynamic = false;
         void *handle;
+        string fileName; // name in the plugins option
 };
 
 using PluginPtr = std::shared_ptr<Plugin>;
@@ -0,0 +1,104 @@
+#ifndef REGION_H
+#define REGION_H
+
+#include "commonincludes.hpp"
+
+/* x1, y1 inclusive, x2, y2 exclusive. Four ints in a row,
+ * so a box can be loaded and compared as a single vector */
+struct alignas(16) FireBox {
+    int x1, y1, x2, y2;
+};
+
+/* scratch memory for region operations. Results are built
+ * here and then copied into the destination region. The
+ * memory is never given back, so after the first frames
+ * region operations don't allocate anything */
+class RegionArena {
+    std::vector<FireBox> boxes;
+    size_t highWater = 0;
+
+    public:
+        size_t mark() const { return boxes.size(); }
+        void release(size_t mark) { boxes.resize(mark); }
+
+        void push(const FireBox &box) { boxes.push_back(box); }
+        void pop() { boxes.pop_back(); }
+        FireBox& operator[] (size_t i) { return boxes[i]; }
+
+        /* called once per frame, nothing should be left
+         * in use between frames */
+        void reset();
+        size_t getHighWater() const { return highWater; }
+};
+
+extern RegionArena regionArena;
+
+/* a set of pixels, stored like an Xlib Region as y-x banded
+ * boxes: boxes are sorted by y, then by x, boxes in a band
+ * have the same y1 and y2 and don't touch each other, and
+ * vertically adjacent bands with the same boxes are merged.
+ *
+ * Small regions (a window, a damage rectangle) are kept
+ * inline, bigger ones in a buffer which grows but is never
+ * shrunk, so a long-lived region like the damage doesn't
+ * allocate after it has reached its usual size */
+class FireRegion {
+    static constexpr int InlineBoxes = 4;
+
+    FireBox inlineBoxes[InlineBoxes];
+    FireBox *boxes = inlineBoxes;
+    int count = 0, capacity = InlineBoxes;
+    FireBox ext = {0, 0, 0, 0};
+
+    enum Op {OpUnion, OpIntersect, OpSubtract};
+
+    void reserve(int n);
+    void assign(const FireBox *src, int n);
+    void apply(const FireRegion &other, Op op);
+
+    public:
+        FireRegion() {}
+        FireRegion(int x1, int y1, int x2, int y2);
+        FireRegion(const FireBox &box);
+        FireRegion(const FireRegion &other);
+        FireRegion(FireRegion &&other);
+        ~FireRegion();
+
+        FireRegion& operator = (const FireRegion &other);
+        FireRegion& operator = (FireRegion &&other);
+
+        bool empty() const { return count == 0; }
+        int size() const { return count; }
+        const FireBox& extents() const { return ext; }
+
+        const FireBox* begin() const { return boxes; }
+        const FireBox* end() const { return boxes + count; }
+
+        void clear();
+
+        void unite(const FireRegion &other);
+        void intersect(const FireRegion &other);
+        void subtract(const FireRegion &other);
+
+        void unite(const FireBox &box);
+        void intersect(const FireBox &box);
+        void subtract(const FireBox &box);
+
+        void translate(int dx, int dy);
+
+        /* number of pixels in the region */
+        int64_t area() const;
+
+        /* fuse boxes until there are at most maxBoxes left,
+         * always taking the merge which adds the fewest pixels.
+         * Returns the number of merges done, or -1 if the region
+         * would grow by more than maxWaste * area(), in which
+         * case it is left as it was */
+        int simplify(int maxBoxes, float maxWaste);
+
+        bool contains(int x, int y) const;
+        /* whether any pixel of the rectangle is in the region */
+        bool overlaps(int x, int y, int w, int h) const;
+        bool overlaps(const FireRegion &other) const;
+};
+#endif
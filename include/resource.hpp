@@ -0,0 +1,35 @@
+#ifndef RESOURCE_H
+#define RESOURCE_H
+
+#include "commonincludes.hpp"
+
+/* LazyResource is used by plugins for GPU resources (programs,
+ * framebuffers, ...) which are needed only while the plugin is
+ * active. They are created on first acquire() and released when
+ * nobody has used them for some time (core option gpuidle, in ms),
+ * so unused plugins take no VRAM and no startup time */
+class LazyResource {
+    std::function<void()> create, release;
+
+    int users = 0;
+    bool created = false;
+    uint timer = -1;
+
+    void cancelTimer();
+
+    public:
+        LazyResource(std::function<void()> create,
+                std::function<void()> release);
+        ~LazyResource();
+
+        /* create the resource if needed and mark it as used */
+        void acquire();
+        /* stop using it, when it has no more users
+         * it will be released after the idle period */
+        void unref();
+        /* release immediately (if there are no users) */
+        void releaseNow();
+
+        bool isCreated();
+};
+#endif
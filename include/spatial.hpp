@@ -0,0 +1,77 @@
+#ifndef SPATIAL_H
+#define SPATIAL_H
+
+#include "core.hpp"
+
+/* uniform grid over the virtual desktop, used to find the windows
+ * at a point or in a rectangle without checking every window.
+ * A window is kept in all cells its bounds touch, windows partly
+ * outside of the grid are kept in the border cells, so a query
+ * never misses a window (but the caller still has to check the
+ * windows it gets, they are only candidates) */
+class SpatialGrid {
+    static constexpr int CellSize = 256;
+
+    int originX = 0, originY = 0;
+    int cols = 0, rows = 0;
+    /* added to screen coordinates to get grid coordinates */
+    int offsetX = 0, offsetY = 0;
+    std::vector<std::vector<FireWin*>> cells;
+
+    /* incremented on each query, so that a window
+     * in several cells is visited only once */
+    uint stamp = 0;
+
+    /* cells touched by box (in screen coordinates),
+     * clamped to the grid, inclusive */
+    FireBox cellRange(const FireBox &box) const;
+
+    template<class Proc>
+    void visit(const FireBox &box, Proc &proc) {
+        if(box.x1 >= box.x2 || box.y1 >= box.y2)
+            return;
+
+        auto r = cellRange(box);
+        for(int y = r.y1; y <= r.y2; y++)
+            for(int x = r.x1; x <= r.x2; x++)
+                for(auto w : cells[y * cols + x])
+                    if(w->gridStamp != stamp)
+                        w->gridStamp = stamp, proc(w);
+    }
+
+    public:
+        /* covered area in grid coordinates.
+         * Windows must be inserted again after this */
+        void reset(int x, int y, int w, int h);
+        bool ready() const { return cols > 0; }
+        bool covers(int x, int y, int w, int h) const {
+            return ready() && originX == x && originY == y &&
+                cols * CellSize >= w && rows * CellSize >= h;
+        }
+
+        /* the grid covers the virtual desktop, but windows are
+         * in screen coordinates, which change with the viewport */
+        void setOffset(int x, int y) { offsetX = x, offsetY = y; }
+
+        void insert(FireWin *win, const FireBox &bounds);
+        void remove(FireWin *win);
+
+        /* calls proc(FireWin*) once for each window in the
+         * cells touched by box or region (screen coordinates) */
+        template<class Proc>
+        void query(const FireBox &box, Proc proc) {
+            if(ready())
+                ++stamp, visit(box, proc);
+        }
+
+        template<class Proc>
+        void query(const FireRegion &region, Proc proc) {
+            if(!ready())
+                return;
+
+            ++stamp;
+            for(auto &box : region)
+                visit(box, proc);
+        }
+};
+#endif
@@ -0,0 +1,47 @@
+#ifndef STACKLIST_H
+#define STACKLIST_H
+
+/* intrusive doubly linked list, linked through T::above and
+ * T::below, top is the topmost element. Each layer of WinStack
+ * is one, so restacking and removing a window are O(1) */
+template<class T>
+struct StackList {
+    T *top = nullptr, *bottom = nullptr;
+    int size = 0;
+
+    /* link t directly above pos, or at the bottom if pos is nullptr */
+    void link(T *t, T *pos) {
+        if(pos) {
+            t->below = pos;
+            t->above = pos->above;
+            pos->above = t;
+        } else {
+            t->below = nullptr;
+            t->above = bottom;
+            bottom = t;
+        }
+
+        if(t->above)
+            t->above->below = t;
+        else
+            top = t;
+
+        size++;
+    }
+
+    void unlink(T *t) {
+        if(t->above)
+            t->above->below = t->below;
+        else
+            top = t->below;
+
+        if(t->below)
+            t->below->above = t->above;
+        else
+            bottom = t->above;
+
+        t->above = t->below = nullptr;
+        size--;
+    }
+};
+#endif
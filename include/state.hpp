@@ -0,0 +1,49 @@
+#ifndef STATE_H
+#define STATE_H
+
+#include "commonincludes.hpp"
+
+/* SharedState lives in shared memory between main() and the
+ * forked Core. Core keeps a snapshot of its state there, so that
+ * after a crash or a Refresh the next Core can restore it
+ * instead of deriving everything again */
+
+#define StateMagic   0x45524946 // "FIRE"
+#define StateVersion 2
+#define MaxSavedWindows 1024
+
+struct SavedWindow {
+    Window id;
+    Window transientFor, leader;
+    int type;
+    uint state;
+    int layer;
+    int vpx, vpy; // see FireWin::vpX
+};
+
+struct SharedState {
+    /* magic is cleared while Core writes the snapshot,
+     * so a partially written snapshot is never used */
+    uint32_t magic;
+    uint32_t version;
+
+    int restart;          // should main() restart Core?
+    uint64_t restartTime; // getTimeMs() at the moment of restart, or 0
+
+    int vx, vy;           // viewport position
+
+    Window activeWin;
+
+    /* windows in stacking order, top first */
+    int numWindows;
+    SavedWindow windows[MaxSavedWindows];
+
+    int numClients;
+    Window clients[MaxSavedWindows];
+};
+
+extern SharedState *shared;
+
+/* returns whether shared contains a complete snapshot */
+bool isStateValid();
+#endif
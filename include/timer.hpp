@@ -0,0 +1,65 @@
+#ifndef TIMER_H
+#define TIMER_H
+
+#include "commonincludes.hpp"
+#include <list>
+#include <functional>
+
+/* timers are used by plugins for delayed actions,
+ * so that they don't have to count frames in a Hook
+ * (enabled hooks keep the main loop from idling) */
+
+using TimerCallback = std::function<void()>;
+
+/* returns current time in milliseconds (monotonic) */
+uint64_t getTimeMs();
+
+/* hierarchical timer wheel: level 0 has a slot for each of
+ * the next 64 ms, each next level is 64 times coarser.
+ * Timers are moved (cascaded) to a lower level when the
+ * lower level wraps around, so adding, removing and expiring
+ * a timer is O(1) */
+class TimerWheel {
+    static constexpr int LevelBits = 6;
+    static constexpr int LevelSize = 1 << LevelBits;
+    static constexpr int LevelMask = LevelSize - 1;
+    static constexpr int Levels    = 4;
+
+    struct Timer {
+        uint id;
+        uint64_t expires;
+        TimerCallback action;
+    };
+
+    using TimerList = std::list<Timer>;
+    struct TimerPos {
+        int level, slot;
+        TimerList::iterator it;
+    };
+
+    TimerList wheel[Levels][LevelSize];
+    std::unordered_map<uint, TimerPos> timers;
+    int count[Levels] = {0};
+
+    uint64_t current; // last processed tick
+
+    void insert(Timer t);
+    void cascade(int level);
+
+    public:
+        TimerWheel();
+
+        void add(uint id, int timeout, TimerCallback action);
+        void remove(uint id);
+        bool exists(uint id);
+        bool empty();
+
+        /* run all timers which expired until now,
+         * returns the number of timers run */
+        int advance(uint64_t now);
+
+        /* milliseconds until the next timer might expire,
+         * -1 if there are no timers */
+        int nextTimeout();
+};
+#endif
@@ -0,0 +1,63 @@
+#ifndef VIEWPORT_H
+#define VIEWPORT_H
+
+#include "region.hpp"
+#include "resource.hpp"
+
+/* textures with the contents of each viewport, shared by all
+ * plugins which need them (cube, expo, ...). Damage is tracked
+ * for each viewport, a texture is rendered again only where its
+ * viewport has been damaged since it was last requested.
+ *
+ * Only damage is tracked, so a plugin which changes the transform
+ * of windows has to call damageAll() (or damage the windows) */
+class ViewportCache {
+    struct Entry {
+        GLuint fbuff = -1, texture = -1;
+        FireRegion damage; // in viewport coordinates
+    };
+
+    std::vector<Entry> entries;
+    int vw = 0, vh = 0, sw = 0, sh = 0;
+    int users = 0;
+
+    /* a screen-sized quad for draw() */
+    GLuint vao = -1, vbo = -1;
+
+    /* framebuffers are created for the first user
+     * and released after they are no longer used */
+    LazyResource textures;
+    void createTextures();
+    void releaseTextures();
+
+    void damageViewport(Entry &e, FireRegion &&r);
+
+    public:
+        ViewportCache();
+
+        /* r is relative to the current viewport */
+        void damage(const FireRegion &r);
+        void damageAll();
+
+        /* call before using getTexture() and unref() when done */
+        void acquire();
+        void unref();
+        /* whether some plugin is showing viewports */
+        bool inUse() const { return users > 0; }
+
+        /* the viewport's texture, up to date */
+        GLuint getTexture(std::tuple<int, int> vp);
+
+        /* draw the viewport's texture over the whole screen,
+         * transformed like Transform::gtrs. The texture is not
+         * updated, as this has to be done before binding the
+         * framebuffer which is drawn to */
+        void draw(std::tuple<int, int> vp, const glm::mat4 &transform);
+
+        /* how often getTexture() was served from the cache,
+         * by rendering the damage only or the whole viewport */
+        struct {
+            uint64_t hits = 0, partial = 0, full = 0;
+        } stats;
+};
+#endif
@@ -1,4 +1,6 @@
 #include "commonincludes.hpp"
+#include "state.hpp"
+#include "region.hpp"
 
 enum WindowType {
     WindowTypeNormal,
@@ -23,23 +25,71 @@ enum WindowState {
 
 #define SizeStates (WindowStateMaxH|WindowStateMaxV|WindowStateFullscreen)
 
+/* a matrix which remembers when it was last changed.
+ * Versions are taken from a single global counter, so the
+ * largest version of a set of matrices changes whenever
+ * any of them changes */
+class TrackedMatrix {
+    static uint64_t counter;
+
+    glm::mat4 value;
+    uint64_t ver;
+
+    public:
+        TrackedMatrix(const glm::mat4 &m = glm::mat4()) : value(m), ver(++counter) {}
+
+        TrackedMatrix& operator = (const glm::mat4 &m) {
+            return value = m, ver = ++counter, *this;
+        }
+        TrackedMatrix& operator = (const TrackedMatrix &m) {
+            return value = m.value, ver = ++counter, *this;
+        }
+        TrackedMatrix& operator *= (const glm::mat4 &m) {
+            return value *= m, ver = ++counter, *this;
+        }
+
+        operator const glm::mat4& () const { return value; }
+        const glm::mat4& get() const { return value; }
+        uint64_t version() const { return ver; }
+};
+
+/* column-major 4x4 multiplication, uses SSE when available */
+glm::mat4 multiplyMatrices(const glm::mat4 &a, const glm::mat4 &b);
+
 class Transform {
     public: // applied to all windows
-        static glm::mat4 grot;
-        static glm::mat4 gscl;
-        static glm::mat4 gtrs;
+        static TrackedMatrix grot;
+        static TrackedMatrix gscl;
+        static TrackedMatrix gtrs;
+        /* moves windows by minus the current viewport,
+         * set by Core when the viewport changes */
+        static TrackedMatrix gviewport;
     public:
-        glm::mat4 rotation;
-        glm::mat4 scalation;
-        glm::mat4 translation;
+        TrackedMatrix rotation;
+        TrackedMatrix scalation;
+        TrackedMatrix translation;
+        /* moves the window by its viewport (FireWin::vpX/vpY),
+         * together with gviewport this places windows which
+         * are not synced to the current viewport */
+        TrackedMatrix viewport;
         glm::vec4 color;
+    private:
+        /* compose() and getMVP() are recomputed only
+         * when one of the matrices above has changed */
+        glm::mat4 model, mvp;
+        uint64_t modelVersion = 0, mvpVersion = 0;
+        bool mvpTransformed = false;
     public:
         Transform();
-        glm::mat4 compose();
+        const glm::mat4& compose();
+        /* compose() with OpenGL's projection and view
+         * applied if OpenGL::transformed is set */
+        const glm::mat4& getMVP();
+        /* changes whenever compose() does */
+        uint64_t version() const { return modelVersion; }
 };
 
-extern Region output;
-Region copyRegion(Region r);
+extern FireRegion output;
 
 struct SharedImage {
     XShmSegmentInfo shminfo;
@@ -51,22 +101,48 @@ struct SharedImage {
 enum Layer {LayerAbove = 0, LayerNormal = 1, LayerBelow = 2};
 
 struct WindowData {
+    virtual ~WindowData() {}
 };
 
+/* plugins keep per-window data in slots, a slot is
+ * allocated once with Core::allocDataSlot() and then
+ * indexes FireWin::data directly */
+#define MaxDataSlots 32
+using DataSlot = int;
+
 struct EffectHook;
 
-#define GetData(type, win, name) ((type*)(win->data[(name)]))
-#define ExistsData(win, name) ((win)->data.find((name)) != (win)->data.end())
-#define AllocData(type, win, name) (win)->data[(name)] = new type()
+/* requests for everything we need to know about a new window.
+ * They are sent at once and their replies are collected later,
+ * so creating many windows costs a single round trip */
+struct WindowCookies {
+    Window id;
+    /* if the window was restored from a saved state,
+     * its type, state, transient and leader are not requested */
+    SavedWindow *saved;
+    xcb_get_window_attributes_cookie_t attrib;
+    xcb_get_geometry_cookie_t          geometry;
+    xcb_get_property_cookie_t          hints, type, transient,
+                                       leader, state, opacity;
+};
+
+/* a slot of -1 (none was free) has no data */
+#define GetData(type, win, slot) ((slot) < 0 ? nullptr : \
+        (type*)((win)->data[(slot)]))
+#define ExistsData(win, slot) ((slot) >= 0 && (win)->data[(slot)] != nullptr)
+#define AllocData(type, win, slot) ((slot) < 0 ? (void)0 : \
+        (void)((win)->data[(slot)] = new type()))
 
 class FireWin {
     public:
 
         FireWin(Window id, bool init = true);
+        /* create from already requested window info */
+        FireWin(WindowCookies &cookies);
         ~FireWin();
         /* this can be used by plugins to store
          * specific for the plugin data */
-        std::unordered_map<std::string, WindowData*> data;
+        WindowData *data[MaxDataSlots] = {nullptr};
         std::unordered_map<uint, EffectHook*> effects;
 
         static bool allDamaged;
@@ -93,16 +169,86 @@ class FireWin {
         std::shared_ptr<FireWin> leader;
         Layer layer;
 
+        /* links in the window's layer in WinStack, above is
+         * closer to the top. While the window is in the stack,
+         * stackRef keeps it alive */
+        FireWin *above = nullptr, *below = nullptr;
+        std::shared_ptr<FireWin> stackRef;
+
+        /* ancestry graph, maintained by WinStack::updateLinks().
+         * ancestors are all windows reachable through transientFor
+         * and leader, dependents are the windows whose transientFor
+         * or leader is this window */
+        std::unordered_set<FireWin*> ancestors;
+        std::vector<FireWin*> dependents;
+        FireWin *linkedTransient = nullptr, *linkedLeader = nullptr;
+        bool inGroup = false; // in WinStack's group of linkedLeader
+
         char *name;
         WindowType type;
         uint state = WindowStateBase;
         XWindowAttributes attrib;
-        Region region = nullptr;
+        FireRegion region;
+
+        /* viewport which attrib (and the window's position in X) is
+         * relative to. After a workspace switch only windows which
+         * become visible or invisible are moved, for the others this
+         * is the viewport from before the switch, see syncViewport().
+         * Windows are synced when they are moved by us, mapped,
+         * focused or when their client sends a request, so that
+         * clients which read their geometry after that see their
+         * real position */
+        int vpX = 0, vpY = 0;
+        void setViewport(int x, int y);
+        /* move the window so that it is relative to core's viewport */
+        void syncViewport();
+        /* what has to be added to attrib to get
+         * the position relative to core's viewport */
+        std::tuple<int, int> getViewportOffset();
+        /* region relative to core's viewport */
+        FireRegion getScreenRegion();
+
+        /* bounding box of the window on screen as it is drawn,
+         * i.e with its transform. Cached until the transform
+         * or the geometry change */
+        const FireBox& getTransformedBox();
+        FireBox transformedBox;
+        FireBox transformedFrom; // x, y, width, height it is for
+        uint64_t transformedVersion = 0;
+        bool transformedProj = false;
+
+        /* damage where the window was drawn at the previous call
+         * and where it is drawn now, with its transform. Plugins
+         * animating the transform call this on each step (and once
+         * more after resetting it) instead of redrawing everything */
+        void damageTransformed();
+        FireBox damagedBox;
+        /* the transform moves the window away from its geometry,
+         * so it is drawn at damagedBox instead */
+        bool transformMoved = false;
 
         Pixmap pixmap = 0;
         SharedImage shared;
 
 
+        /* entry in WinStack's render list, -1 if none */
+        int renderIndex = -1;
+        bool renderDirty = false;
+        static std::vector<FireWin*> dirtyWindows;
+
+        /* cells of WinStack's spatial grid the window is in */
+        FireBox gridCells;
+        bool inGrid = false;
+        uint gridStamp = 0;
+
+        /* must be called after changing anything isVisible()
+         * or transparent depend on, so that the window's entry
+         * in the render list is updated. Geometry changes
+         * through updateRegion() do it already */
+        void markDirty();
+
+        /* visible unless it is only out of screen */
+        bool isRenderable();
         bool isVisible();
         bool shouldBeDrawn();
         void updateVBO();
@@ -111,6 +257,8 @@ class FireWin {
 
         void addDamage();
 
+        /* without configure, x and y come from the server and
+         * are relative to vpX/vpY, the window isn't synced */
         void move(int x, int y, bool configure = true);
         void resize(int w, int h, bool configure = true);
 
@@ -119,11 +267,13 @@ class FireWin {
         void moveResize(int x, int y, int w, int h);
 
         void syncAttrib();
+        void syncAttrib(xcb_get_window_attributes_cookie_t attribCookie,
+                xcb_get_geometry_cookie_t geometryCookie);
         void getInputFocus();
 
         void render();
         int  setTexture();
-        void init();
+        void init(WindowCookies &cookies);
         void fini();
 };
 
@@ -158,12 +308,35 @@ class Core;
 
 namespace WinUtil {
     void init();
-    FireWindow getTransient(Window win);
     void       getWindowName(Window win, char *name);
-    FireWindow getClientLeader(Window win);
 
-    int         readProp(Window win, Atom prop, int def);
-    WindowType  getWindowType (Window win);
-    uint        getWindowState(Window win);
+    /* send all requests needed to create a window */
+    WindowCookies requestWindowInfo(Window win, SavedWindow *saved = nullptr);
+    xcb_get_property_cookie_t requestProperty(Window win, Atom prop);
+    /* fills xwa from the replies, returns false if any is missing */
+    bool getAttrib(XWindowAttributes &xwa,
+            xcb_get_window_attributes_reply_t *attribReply,
+            xcb_get_geometry_reply_t *geometryReply);
+
+    /* wait for the reply to cookie. If the request failed,
+     * NULL is returned and the error is dropped, otherwise
+     * xcb would report it to Xlib's error handler */
+    template<class Reply, class Cookie>
+    Reply *getReply(xcb_connection_t *c, Cookie cookie,
+            Reply *(*replyFunc)(xcb_connection_t*, Cookie, xcb_generic_error_t**)) {
+
+        xcb_generic_error_t *error = NULL;
+        auto reply = replyFunc(c, cookie, &error);
+        free(error);
+        return reply;
+    }
+
+    /* these parse property replies, which may be NULL */
+    FireWindow  getTransient   (xcb_get_property_reply_t *reply);
+    FireWindow  getClientLeader(Window win, xcb_get_property_reply_t *reply);
+    int         readProp       (xcb_get_property_reply_t *reply, int def);
+    WindowType  getWindowType  (xcb_get_property_reply_t *reply);
+    uint        getWindowState (xcb_get_property_reply_t *reply);
+
     bool        constrainNewWindowPosition(int &x, int &y);
 }
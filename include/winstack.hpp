@@ -1,7 +1,8 @@
 #ifndef WINSTACK_H
 #define WINSTACK_H
 #include "core.hpp"
-#include <list>
+#include "spatial.hpp"
+#include "stacklist.hpp"
 
 
 enum StackType{
@@ -11,22 +12,62 @@ enum StackType{
     StackTypeNoStacking = 8
 };
 
-using WindowProc = std::function<void(FireWindow)>;
-
 class WinStack {
     private:
 
         /* LayerAbove is for dialogs & docks
          * LayerNormal is for normal windows
-         * and LayerBelow is for desktop windows */
+         * and LayerBelow is for desktop windows.
+         *
+         * Each layer is an intrusive list linked through
+         * FireWin::above/below, top is the topmost window */
+        using StackLayer = StackList<FireWin>;
 
-        std::vector<std::list<FireWindow> >layers;
+        static constexpr int NumLayers = 3;
+        StackLayer layers[NumLayers];
         std::unordered_set<Window> clientList;
+        std::vector<FireWin*> drawList; // see renderWindows()
+
+        /* compact copy of what renderWindows() checks each frame,
+         * in stacking order (top first). It is rebuilt when the
+         * stack changes, entries of windows marked dirty
+         * (see FireWin::markDirty()) are updated before rendering */
+        struct RenderList {
+            enum Flags { Renderable = 1, OnScreen = 2, Opaque = 4 };
+            struct Bounds { int x, y, w, h; };
+
+            std::vector<FireWin*> wins;
+            std::vector<Bounds> bounds; // as drawn, with the viewport offset
+            std::vector<uint8_t> flags;
+            bool rebuild = true;
+        };
+        RenderList renderList;
+        void updateRenderEntry(int i);
+        void updateRenderList();
+
+        /* all windows in the stack, by their bounds. Entries
+         * are updated together with the render list */
+        SpatialGrid grid;
+        void updateGridEntry(FireWin *win);
+        std::vector<int> drawOrder; // see renderWindows()
 
-        typedef std::list<FireWindow>::iterator StackIterator;
+        /* link win directly above pos, or at the bottom
+         * of layer if pos is nullptr */
+        void link(FireWin *win, Layer layer, FireWin *pos);
+        void unlink(FireWin *win);
+        bool inStack(FireWindow win);
 
-        StackIterator getIteratorPositionForWindow(FireWindow win);
-        bool recurseIsAncestor(FireWindow parent, FireWindow win);
+        /* widgets and modals by their leader, see isTransientInGroup() */
+        std::unordered_map<FireWin*, std::vector<FireWin*>> groups;
+
+        void unregisterLinks(FireWin *win);
+        /* drops the links of other windows to win,
+         * when win leaves the stack */
+        void unregisterDependents(FireWin *win);
+        void updateAncestors(FireWin *win,
+                std::unordered_set<FireWin*> &visited);
+        void collectDescendants(FireWin *win,
+                std::unordered_set<FireWin*> &result);
 
         void addClient(FireWindow win);
         void removeClient(FireWindow win);
@@ -44,7 +85,70 @@ class WinStack {
         FireWindow findWindow(Window win);
         FireWindow getTopmostToplevel();
         void renderWindows();
-        void forEachWindow(WindowProc proc);
+
+        /* windows drawn or skipped because their transform puts
+         * them off-screen, while everything is redrawn */
+        struct {
+            uint64_t drawn = 0, culled = 0;
+        } cullStats;
+
+        /* must be called when the size of the virtual desktop
+         * or the viewport changes */
+        void updateGrid();
+        /* windows whose bounds intersect box (screen coordinates),
+         * in stacking order (top first). The caller has to check
+         * them, these are only candidates */
+        std::vector<FireWindow> getWindowsInRect(const FireBox &box);
+
+        /* traversal of the stack. Windows are passed as const
+         * FireWindow& to proc, so nothing is copied. Top-down
+         * visits the topmost window of LayerAbove first.
+         * proc must not add or remove windows */
+        template<class Proc>
+        void forEachWindowInLayer(Layer layer, Proc proc, bool bottomUp = false) {
+            auto &l = layers[layer];
+            if(bottomUp)
+                for(auto w = l.bottom; w; w = w->above)
+                    proc(w->stackRef);
+            else
+                for(auto w = l.top; w; w = w->below)
+                    proc(w->stackRef);
+        }
+
+        template<class Proc>
+        void forEachWindow(Proc proc) {
+            for(int layer = 0; layer < NumLayers; layer++)
+                forEachWindowInLayer(Layer(layer), proc);
+        }
+
+        template<class Proc>
+        void forEachWindowBottomUp(Proc proc) {
+            for(int layer = NumLayers - 1; layer >= 0; layer--)
+                forEachWindowInLayer(Layer(layer), proc, true);
+        }
+
+        template<class Pred, class Proc>
+        void forEachWindowIf(Pred pred, Proc proc) {
+            forEachWindow([&pred, &proc] (const FireWindow &w) {
+                    if(pred(w)) proc(w);
+                });
+        }
+
+        /* returns the topmost window for which pred is true */
+        template<class Pred>
+        FireWindow findWindowIf(Pred pred) {
+            for(auto &l : layers)
+                for(auto w = l.top; w; w = w->below)
+                    if(pred(w->stackRef))
+                        return w->stackRef;
+            return nullptr;
+        }
+
+        void saveState(SharedState *state);
+        /* add windows restored from state, restored must be
+         * in stacking order (top first) and have their layer set */
+        void restoreWindows(std::vector<FireWindow> &restored,
+                SharedState *state);
 
         void checkAddClient(FireWindow win);
         void checkRemoveClient(FireWindow win);
@@ -54,6 +158,9 @@ class WinStack {
         void restackAbove(FireWindow above, FireWindow below, bool rstr = true);
         FireWindow findWindowAtCursorPosition(int x, int y);
 
+        /* must be called when transientFor, leader
+         * or type of a window in the stack changes */
+        void updateLinks(FireWindow win);
         void restackTransients(FireWindow win);
         FireWindow findTopmostStackingWindow(FireWindow win);
 
@@ -7,8 +7,12 @@
 
 bool Animation::Step() {return false;}
 bool Animation::Run() {return true;}
+void Animation::Finish() {}
 Animation::~Animation() {}
 
+/* running animations, they are finished when the plugin is unloaded */
+std::unordered_set<AnimationHook*> animationHooks;
+
 AnimationHook::AnimationHook(Animation *_anim) {
     this->anim = _anim;
     if(anim->Run()) {
@@ -16,6 +20,7 @@ AnimationHook::AnimationHook(Animation *_anim) {
             std::bind(std::mem_fn(&AnimationHook::Step), this);
         core->addHook(&hook);
         this->hook.enable();
+        animationHooks.insert(this);
     }
     else {
         delete anim;
@@ -26,15 +31,26 @@ AnimationHook::AnimationHook(Animation *_anim) {
 void AnimationHook::Step() {
     if(!this->anim->Step()) {
         core->remHook(hook.id);
+        animationHooks.erase(this);
         delete anim;
         delete this;
     }
 }
 
+void AnimationHook::Finish() {
+    anim->Finish();
+    core->remHook(hook.id);
+    animationHooks.erase(this);
+    delete anim;
+    delete this;
+}
+
 class AnimatePlugin : public Plugin {
     SignalListener map, unmap;
 
     std::string map_animation;
+    Option<int> fade_duration;
+    Option<string> map_animation_opt;
 
     public:
         void initOwnership() {
@@ -43,8 +59,8 @@ class AnimatePlugin : public Plugin {
         }
 
         void updateConfiguration() {
-            fadeDuration = options["fade_duration"]->data.ival;
-            map_animation = *options["map_animation"]->data.sval;
+            fadeDuration = *fade_duration;
+            map_animation = *map_animation_opt;
             if(map_animation == "fire") {
                 if(!HAS_COMPUTE_SHADER) {
                     std::cout << "[EE] OpenGL version below 4.3," <<
@@ -56,8 +72,8 @@ class AnimatePlugin : public Plugin {
         }
 
         void init() {
-            options.insert(newIntOption("fade_duration", 150));
-            options.insert(newStringOption("map_animation", "fade"));
+            fade_duration     = addOption("fade_duration", 150);
+            map_animation_opt = addOption("map_animation", "fade");
 
             using namespace std::placeholders;
             map.action = std::bind(std::mem_fn(&AnimatePlugin::mapWindow),
@@ -65,26 +81,51 @@ class AnimatePlugin : public Plugin {
             unmap.action = std::bind(std::mem_fn(&AnimatePlugin::unmapWindow),
                         this, _1);
 
-            core->connectSignal("map-window", &map);
-            core->connectSignal("unmap-window", &unmap);
+            core->connectSignal(core->mapWindowSignal, &map);
+            core->connectSignal(core->unmapWindowSignal, &unmap);
+
+            firePrograms = new LazyResource(loadFirePrograms,
+                    releaseFirePrograms);
+            fadeSlot = core->allocDataSlot();
+            if(fadeSlot < 0)
+                std::cout << "[WW] animate: no window data slot, " <<
+                    "fades of a window can overlap" << std::endl;
         }
 
-        void mapWindow(SignalListenerData data) {
-            auto win = *((FireWindow*) data[0]);
+        void mapWindow(SignalData &data) {
+            auto win = static_cast<MapWindowSignal&>(data).win;
             if(map_animation == "fire")
                 new Fire(win);
             else
                 new AnimationHook(new Fade<FadeIn>(win));
         }
 
-        void unmapWindow(SignalListenerData data) {
-            auto win = *((FireWindow*) data[0]);
+        void unmapWindow(SignalData &data) {
+            auto win = static_cast<MapWindowSignal&>(data).win;
             new AnimationHook(new Fade<FadeOut>(win));
         }
 
         void fini() {
-            core->disconnectSignal("map-window", map.id);
-            core->disconnectSignal("unmap-window", unmap.id);
+            core->disconnectSignal(core->mapWindowSignal, map.id);
+            core->disconnectSignal(core->unmapWindowSignal, unmap.id);
+
+            /* their hooks are removed together with the plugin,
+             * so windows would stay half transparent */
+            auto hooks = animationHooks;
+            for(auto h : hooks)
+                h->Finish();
+
+            auto fires = fireEffects;
+            for(auto f : fires)
+                f->finish();
+
+            /* the timers which would clear the last particles
+             * are removed together with the plugin */
+            if(!fires.empty())
+                core->damageRegion(output);
+
+            delete firePrograms;
+            core->freeDataSlot(fadeSlot);
         }
 };
 
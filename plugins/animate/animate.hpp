@@ -7,6 +7,7 @@ class Animation {
     public:
     virtual bool Step(); /* return true if continue, false otherwise */
     virtual bool Run(); /* should we start? */
+    virtual void Finish(); /* jump to the end, as if it was the last Step */
     virtual ~Animation();
 };
 
@@ -16,6 +17,8 @@ class AnimationHook {
     public:
     AnimationHook(Animation *_anim);
     void Step();
+    /* finish the animation now and delete it, see AnimatePlugin::fini */
+    void Finish();
 };
 
 #endif
@@ -2,6 +2,7 @@
 #include "fade.hpp"
 
 int fadeDuration;
+DataSlot fadeSlot = -1;
 struct FadeWindowData : public WindowData {
     bool fadeIn = false; // used to prevent activation
     bool fadeOut = false; // of fading multiple times
@@ -12,20 +13,23 @@ struct FadeWindowData : public WindowData {
 template<>
 Fade<FadeIn>::Fade (FireWindow _win) : win(_win), run(true) {
 
-    /* exit if already running */
-    if(ExistsData(win, "fade")) {
-        auto data = GetData(FadeWindowData, win, "fade");
+    /* exit if already running, without a slot
+     * this can't be known, so the fade just runs */
+    if(ExistsData(win, fadeSlot)) {
+        auto data = GetData(FadeWindowData, win, fadeSlot);
         if(data->fadeIn)
             run = false;
     }
-    else AllocData(FadeWindowData, win, "fade"),
-        GetData(FadeWindowData, win, "fade")->fadeIn = true;
+    else if(fadeSlot >= 0)
+        AllocData(FadeWindowData, win, fadeSlot),
+        GetData(FadeWindowData, win, fadeSlot)->fadeIn = true;
 
     if(!run) return;
 
     savetr = win->transparent;
     win->transparent = true;
     win->keepCount++;
+    win->markDirty();
 
     target = maxstep = getSteps(fadeDuration);
     progress = 0;
@@ -34,16 +38,18 @@ Fade<FadeIn>::Fade (FireWindow _win) : win(_win), run(true) {
 template<> bool Fade<FadeIn>::Step() {
     progress++;
     win->transform.color[3] = (float(progress) / float(maxstep));
-    win->addDamage();
+    win->damageTransformed();
 
     if(progress == target) {
         if(restoretr)
             win->transparent = savetr;
 
-        GetData(FadeWindowData, win, "fade")->fadeIn = false;
+        if(ExistsData(win, fadeSlot))
+            GetData(FadeWindowData, win, fadeSlot)->fadeIn = false;
 
         win->transparent = savetr;
         win->keepCount--;
+        win->markDirty();
 
         return false;
     }
@@ -51,6 +57,10 @@ template<> bool Fade<FadeIn>::Step() {
 }
 
 template<> bool Fade<FadeIn>::Run() { return this->run; }
+template<> void Fade<FadeIn>::Finish() {
+    progress = target - 1;
+    Step();
+}
 template<> Fade<FadeIn>::~Fade() {}
 /* FadeIn  end */
 
@@ -58,22 +68,25 @@ template<> Fade<FadeIn>::~Fade() {}
 template<>
 Fade<FadeOut>::Fade (FireWindow _win) : win(_win), run(true) {
 
-    /* exit if already running */
-    if(ExistsData(win, "fade")) {
-        if(GetData(FadeWindowData, win, "fade")->fadeOut)
+    /* exit if already running, see FadeIn */
+    if(ExistsData(win, fadeSlot)) {
+        if(GetData(FadeWindowData, win, fadeSlot)->fadeOut)
             run = false;
     }
-    else AllocData(FadeWindowData, win, "fade"),
-        GetData(FadeWindowData, win, "fade")->fadeOut = true;
+    else if(fadeSlot >= 0)
+        AllocData(FadeWindowData, win, fadeSlot),
+        GetData(FadeWindowData, win, fadeSlot)->fadeOut = true;
 
     if(!run) return;
 
-    if(GetData(FadeWindowData, win, "fade")->fadeIn)
+    if(ExistsData(win, fadeSlot) &&
+            GetData(FadeWindowData, win, fadeSlot)->fadeIn)
         restoretr = false;
 
     savetr = win->transparent;
     win->keepCount++;
     win->transparent = true;
+    win->markDirty();
 
     progress = maxstep = getSteps(fadeDuration);
     target = 0;
@@ -83,21 +96,24 @@ template<>
 bool Fade<FadeOut>::Step() {
     progress--;
     win->transform.color[3] = (float(progress) / float(maxstep));
-    win->addDamage();
+    win->damageTransformed();
 
     if(progress == target) {
         if(restoretr)
             win->transparent = savetr;
 
-        GetData(FadeWindowData, win, "fade")->fadeOut = false;
+        if(ExistsData(win, fadeSlot))
+            GetData(FadeWindowData, win, fadeSlot)->fadeOut = false;
 
         win->transparent = savetr;
         win->keepCount--;
+        win->markDirty();
 
         if(!win->keepCount) {
 
             /* window is now unmapped */
             win->norender = true;
+            win->markDirty();
             XFreePixmap(core->d, win->pixmap);
 
             core->focusWindow(core->getActiveWindow());
@@ -112,5 +128,9 @@ bool Fade<FadeOut>::Step() {
 }
 
 template<> bool Fade<FadeOut>::Run() { return this->run; }
+template<> void Fade<FadeOut>::Finish() {
+    progress = target + 1;
+    Step();
+}
 template<> Fade<FadeOut>::~Fade() {}
 /* FadeOut end */
@@ -1,6 +1,7 @@
 #include "animate.hpp"
 
 extern int fadeDuration;
+extern DataSlot fadeSlot;
 enum FadeMode { FadeIn = 1, FadeOut = -1 };
 template<FadeMode mode> class Fade : public Animation {
     FireWindow win;
@@ -15,6 +16,7 @@ template<FadeMode mode> class Fade : public Animation {
     Fade(FireWindow w);
     bool Step();
     bool Run();
+    void Finish();
     ~Fade();
 };
 
@@ -18,31 +18,66 @@ bool run = true;
  * so that we don't create 2+ particle systems
  * for the same window */
 std::unordered_set<Window> animating_windows;
+std::unordered_set<Fire*> fireEffects;
+
+LazyResource *firePrograms;
+namespace {
+    GLuint fireRenderProg, fireComputeProg;
+}
+
+void loadFirePrograms() {
+    std::string shaderSrcPath = "/usr/local/share/fireman/animate/shaders";
+
+    fireRenderProg = glCreateProgram();
+    GLuint vss, fss, css;
+
+    vss = GLXUtils::loadShader(std::string(shaderSrcPath)
+            .append("/vertex.glsl").c_str(), GL_VERTEX_SHADER);
+
+    fss = GLXUtils::loadShader(std::string(shaderSrcPath)
+            .append("/frag.glsl").c_str(), GL_FRAGMENT_SHADER);
+
+    glAttachShader (fireRenderProg, vss);
+    glAttachShader (fireRenderProg, fss);
+
+    glBindFragDataLocation (fireRenderProg, 0, "outColor");
+    glLinkProgram (fireRenderProg);
+    glUseProgram(fireRenderProg);
+    glUniform1f(1, PARTICLE_SIZE);
+
+    fireComputeProg = glCreateProgram();
+    css = GLXUtils::loadShader(std::string(shaderSrcPath)
+                .append("/fire_compute.glsl").c_str(),
+                GL_COMPUTE_SHADER);
+
+    glAttachShader(fireComputeProg, css);
+    glLinkProgram(fireComputeProg);
+    glUseProgram(0);
+}
+
+void releaseFirePrograms() {
+    glDeleteProgram(fireRenderProg);
+    glDeleteProgram(fireComputeProg);
+}
 
 class FireParticleSystem : public ParticleSystem {
     float _cx, _cy;
     float _w, _h;
 
     float wind, gravity;
+    glm::vec4 startColor, endColor;
 
     public:
 
-    void loadComputeProgram() {
-        std::string shaderSrcPath = "/usr/local/share/fireman/animate/shaders";
-
-        computeProg = glCreateProgram();
-        GLuint css =
-            GLXUtils::loadShader(std::string(shaderSrcPath)
-                    .append("/fire_compute.glsl").c_str(),
-                    GL_COMPUTE_SHADER);
-
-        glAttachShader(computeProg, css);
-        glLinkProgram(computeProg);
-        glUseProgram(computeProg);
+    void loadGLPrograms() {
+        renderProg  = fireRenderProg;
+        computeProg = fireComputeProg;
+        sharedPrograms = true;
+    }
 
-        glUniform1f(1, particleLife);
-        glUniform1f(5, _w);
-        glUniform1f(6, _h);
+    void setParticleColor(glm::vec4 scol, glm::vec4 ecol) {
+        startColor = scol, endColor = ecol;
+        ParticleSystem::setParticleColor(scol, ecol);
     }
 
     void genBaseMesh() {
@@ -82,10 +117,6 @@ class FireParticleSystem : public ParticleSystem {
             initGLPart();
             setParticleColor(glm::vec4(0, 0.5, 1, 1), glm::vec4(0, 0, 0.7, 0.2));
 
-            glUseProgram(renderProg);
-            glUniform1f(1, particleSize);
-            glUseProgram(0);
-
             //wind = 0;
         }
 
@@ -110,7 +141,12 @@ class FireParticleSystem : public ParticleSystem {
     }
 
     void simulate() {
-        glUseProgram(computeProg);
+        /* the program is shared with other effects,
+         * so all our uniforms must be set again */
+        ParticleSystem::setParticleColor(startColor, endColor);
+        glUniform1f(1, particleLife);
+        glUniform1f(5, _w);
+        glUniform1f(6, _h);
         glUniform1f(7, wind);
         ParticleSystem::simulate();
 
@@ -154,6 +190,8 @@ Fire::Fire(FireWindow win) : w(win) {
         MAX_PARTICLES *  w / float(sw) * h / float(sh);
 
     std::cout << "INITIATING WITH " << numParticles << " " << numParticles / 384 << std::endl;
+    firePrograms->acquire();
+    fireEffects.insert(this);
     ps = new FireParticleSystem(avg(tlx, brx), avg(tly, bry),
             w / float(sw), h / float(sh), numParticles);
 
@@ -164,6 +202,11 @@ Fire::Fire(FireWindow win) : w(win) {
     hook.enable();
 
     win->transform.color[3] = 0;
+    /* windows below are seen through it */
+    savetr = win->transparent;
+    win->transparent = true;
+    win->markDirty();
+
     transparency.action = std::bind(std::mem_fn(&Fire::adjustAlpha), this);
     core->addHook(&transparency);
     transparency.enable();
@@ -171,7 +214,7 @@ Fire::Fire(FireWindow win) : w(win) {
     moveListener.action =
         std::bind(std::mem_fn(&Fire::handleWindowMoved),
                 this, std::placeholders::_1);
-    core->connectSignal("move-window", &moveListener);
+    core->connectSignal(core->moveWindowSignal, &moveListener);
 
 
     if(animating_windows.find(this->w->id) != animating_windows.end()) {
@@ -184,13 +227,31 @@ Fire::Fire(FireWindow win) : w(win) {
     unmapListener.action =
         std::bind(std::mem_fn(&Fire::handleWindowUnmapped),
                 this, std::placeholders::_1);
-    core->connectSignal("unmap-window", &unmapListener);
+    core->connectSignal(core->unmapWindowSignal, &unmapListener);
 
-    /* TODO : Check if necessary */
-    core->setRedrawEverything(true);
     OpenGL::useDefaultProgram();
 }
 
+FireBox Fire::getDamageBox() {
+    auto &a = w->attrib;
+    GetTuple(dx, dy, w->getViewportOffset());
+    GetTuple(sw, sh, core->getScreenSize());
+
+    /* particles start at the bottom of the window and in each
+     * step of their life rise by at most dy + wind + noise, and
+     * sink by at most the noise (see fire_compute.glsl) */
+    float noise = 1. / 40. * a.height / 2.;
+    float rise = (2. / EFFECT_CYCLES + 0.002 * RESP_INTERVAL * BURSTS) *
+        a.height / 2. + noise;
+    int margin = std::ceil(PARTICLE_SIZE * sw / 2.);
+
+    int bottom = a.y + dy + a.height;
+    int top = std::min(a.y + dy, int(bottom - rise * (MAX_LIFE + 1)));
+    return FireBox{a.x + dx - margin, top - margin,
+        a.x + dx + a.width + margin,
+        int(bottom + noise * (MAX_LIFE + 1)) + margin};
+}
+
 void Fire::step() {
     ps->simulate();
 
@@ -198,17 +259,22 @@ void Fire::step() {
         ps->render();
     OpenGL::useDefaultProgram();
 //
-    if(!ps->check()) {
-        w->transform.color[3] = 1;
+    if(!ps->check())
+        finish();
+}
 
-        core->remHook(transparency.id);
-        core->remEffect(hook.id, w);
-        core->disconnectSignal("move-window", moveListener.id);
-        core->disconnectSignal("unmap-window", unmapListener.id);
+void Fire::finish() {
+    w->transform.color[3] = 1;
+    w->transparent = savetr;
+    w->markDirty();
 
-        animating_windows.erase(w->id);
-        delete this;
-    }
+    core->remHook(transparency.id);
+    core->remEffect(hook.id, w);
+    core->disconnectSignal(core->moveWindowSignal, moveListener.id);
+    core->disconnectSignal(core->unmapWindowSignal, unmapListener.id);
+
+    animating_windows.erase(w->id);
+    delete this;
 }
 
 void Fire::adjustAlpha() {
@@ -218,15 +284,18 @@ void Fire::adjustAlpha() {
 
     w->transform.color[3] = c;
     ++progress;
+
+    /* for the frame which is about to be drawn */
+    core->damageRegion(getDamageBox());
 }
 
-void Fire::handleWindowMoved(SignalListenerData d) {
-    FireWin *w = (FireWin*)d[0];
-    if(w->id != this->w->id)
+void Fire::handleWindowMoved(SignalData &data) {
+    auto &d = static_cast<MoveWindowSignal&>(data);
+    if(d.win->id != this->w->id)
         return;
 
-    int dx = *(int*)d[1];
-    int dy = *(int*)d[2];
+    int dx = d.dx;
+    int dy = d.dy;
 
     GetTuple(sw, sh, core->getScreenSize());
 
@@ -237,34 +306,23 @@ void Fire::handleWindowMoved(SignalListenerData d) {
     OpenGL::useDefaultProgram();
 }
 
-void Fire::handleWindowUnmapped(SignalListenerData d) {
-    FireWindow ww = *(FireWindow*)d[0];
+void Fire::handleWindowUnmapped(SignalData &data) {
+    FireWindow ww = static_cast<MapWindowSignal&>(data).win;
     if(ww->id == w->id) {
         ps->disable();
         step();
     }
 }
 
-struct RedrawOnceMoreHook {
-    Hook h;
-    RedrawOnceMoreHook() {
-        h.action = std::bind(std::mem_fn(&RedrawOnceMoreHook::step), this);
-        core->addHook(&h);
-        h.enable();
-    }
-
-    void step() {
-        core->damageRegion(core->getMaximisedRegion());
-        core->remHook(h.id);
-        delete this;
-        OpenGL::useDefaultProgram();
-    }
-};
-
 Fire::~Fire() {
+    fireEffects.erase(this);
     delete ps;
-    core->setRedrawEverything(false);
-    core->damageRegion(core->getMaximisedRegion());
-
-    new RedrawOnceMoreHook();
+    firePrograms->unref();
+
+    /* this is called while drawing, so the
+     * last particles are cleared on the next cycle */
+    auto box = getDamageBox();
+    core->addTimer(0, [box] () {
+        core->damageRegion(box);
+    });
 }
@@ -6,6 +6,16 @@
 
 class FireParticleSystem;
 
+/* programs are shared by all Fire effects, they are compiled
+ * when the first effect starts and released when idle */
+extern LazyResource *firePrograms;
+void loadFirePrograms();
+void releaseFirePrograms();
+
+/* all running Fire effects */
+class Fire;
+extern std::unordered_set<Fire*> fireEffects;
+
 class Fire {
     FireParticleSystem *ps;
     FireWindow w;
@@ -16,13 +26,20 @@ class Fire {
                    unmapListener;
 
     int progress = 0;
+    bool savetr;
+
+    /* where the window and the particles can be,
+     * relative to the current viewport */
+    FireBox getDamageBox();
 
     public:
         Fire(FireWindow win);
         void step();
+        /* restore the window, remove the effect and delete it */
+        void finish();
         void adjustAlpha();
-        void handleWindowMoved(SignalListenerData d);
-        void handleWindowUnmapped(SignalListenerData d);
+        void handleWindowMoved(SignalData &data);
+        void handleWindowUnmapped(SignalData &data);
 
         ~Fire();
 };
@@ -215,8 +215,9 @@ ParticleSystem::~ParticleSystem() {
     glDeleteVertexArrays(1, &vao);
     glUseProgram(0);
 
-    glDeleteProgram(renderProg);
-    glDeleteProgram(computeProg);
+    if(!sharedPrograms)
+        glDeleteProgram(renderProg),
+        glDeleteProgram(computeProg);
 }
 
 void ParticleSystem::pause () {spawnNew = false;}
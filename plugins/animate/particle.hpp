@@ -37,6 +37,8 @@ class ParticleSystem {
 
     GLint renderProg,
           computeProg;
+    /* set if the programs are not owned by this system */
+    bool sharedPrograms = false;
     GLuint vao;
     GLuint base_mesh;
 
@@ -6,13 +6,10 @@ class Cube : public Plugin {
     ButtonBinding zoomIn, zoomOut;
 
     Hook mouse;
-    std::vector<GLuint> sides;
-    std::vector<GLuint> sideFBuffs;
+    std::vector<GLuint> sides; // see ViewportCache
     int vx, vy;
 
-    float Velocity = 0.01;
-    float VVelocity = 0.01;
-    float ZVelocity = 0.05;
+    Option<float> Velocity, VVelocity, ZVelocity;
     float MaxFactor = 10;
 
     float angle;      // angle between sides
@@ -27,6 +24,10 @@ class Cube : public Plugin {
     GLuint program;
     GLuint vao, vbo;
 
+    /* program, buffers and side framebuffers */
+    LazyResource gl {std::bind(std::mem_fn(&Cube::initGL), this),
+                     std::bind(std::mem_fn(&Cube::finiGL), this)};
+
     GLuint vpID;
     GLuint initialModel;
     GLuint nmID;
@@ -34,8 +35,9 @@ class Cube : public Plugin {
     glm::mat4 vp, model, view;
     float coeff;
 
-    Button actButton;
-    Color bg;
+    Option<Button> actButton;
+    Option<Color> bg;
+    Option<int> deform, light;
 
     public:
         void initOwnership() {
@@ -43,29 +45,30 @@ class Cube : public Plugin {
             owner->compatAll = false;
         }
 
-        void updateConfiguration() {
-            Velocity  = options["velocity" ]->data.fval;
-            VVelocity = options["vvelocity"]->data.fval;
-            ZVelocity = options["zvelocity"]->data.fval;
+        void updateUniforms() {
+            if(OpenGL::VersionMajor < 4)
+                return;
 
-            if(OpenGL::VersionMajor >= 4) {
-                int val = options["deform"]->data.ival;
-                glUseProgram(program);
-                GLuint defID = glGetUniformLocation(program, "deform");
-                glUniform1i(defID, val);
+            int val = *deform;
+            glUseProgram(program);
+            GLuint defID = glGetUniformLocation(program, "deform");
+            glUniform1i(defID, val);
 
-                val = options["light"]->data.ival ? 1 : 0;
-                GLuint lightID = glGetUniformLocation(program, "light");
-                glUniform1i(lightID, val);
+            val = *light ? 1 : 0;
+            GLuint lightID = glGetUniformLocation(program, "light");
+            glUniform1i(lightID, val);
 
-                OpenGL::useDefaultProgram();
-            }
+            OpenGL::useDefaultProgram();
+        }
 
-            actButton = *options["activate"]->data.but;
-            bg = *options["bg"]->data.color;
+        void updateConfiguration() {
+            if(gl.isCreated())
+                updateUniforms();
 
-            if(actButton.button == 0)
+            if(actButton->button == 0) {
+                activate.disable();
                 return;
+            }
 
             using namespace std::placeholders;
 
@@ -80,14 +83,14 @@ class Cube : public Plugin {
             core->addBut(&zoomIn , false);
 
 
-            activate.button = actButton.button;
+            activate.button = actButton->button;
             activate.type = BindingTypePress;
-            activate.mod = actButton.mod;
+            activate.mod = actButton->mod;
             activate.action =
                 std::bind(std::mem_fn(&Cube::Initiate), this, _1);
             core->addBut(&activate, true);
 
-            deactiv.button = actButton.button;
+            deactiv.button = actButton->button;
             deactiv.mod    = AnyModifier;
             deactiv.type   = BindingTypeRelease;
             deactiv.action =
@@ -97,27 +100,34 @@ class Cube : public Plugin {
         }
 
         void init() {
-            options.insert(newFloatOption("velocity",  0.01));
-            options.insert(newFloatOption("vvelocity", 0.01));
-            options.insert(newFloatOption("zvelocity", 0.05));
+            Velocity  = addOption("velocity",  0.01f);
+            VVelocity = addOption("vvelocity", 0.01f);
+            ZVelocity = addOption("zvelocity", 0.05f);
 
-            options.insert(newColorOption("bg", Color{0, 0, 0}));
-            options.insert(newButtonOption("activate", Button{0, 0}));
+            bg        = addOption("bg", Color{0, 0, 0});
+            actButton = addOption("activate", Button{0, 0});
 
             /* these features require tesselation,
              * so if OpenGL version < 4 do not expose
              * such capabilities */
             if(OpenGL::VersionMajor >= 4) {
-                options.insert(newIntOption  ("deform",    0));
-                options.insert(newIntOption  ("light",     false));
+                deform = addOption("deform", 0);
+                light  = addOption("light",  0);
             }
 
+            mouse.action = std::bind(std::mem_fn(&Cube::mouseMoved), this);
+            core->addHook(&mouse);
+
+            renderer = std::bind(std::mem_fn(&Cube::Render), this);
+        }
+
+        /* GL resources are created on first activation */
+        void initGL() {
             std::string shaderSrcPath =
                 "/usr/local/share/fireman/cube/s4.0";
             if(OpenGL::VersionMajor < 4)
                 shaderSrcPath = "/usr/local/share/fireman/cube/s3.3";
 
-
             program = glCreateProgram();
             GLuint vss, fss, tcs = -1, tes = -1, gss = -1;
 
@@ -197,18 +207,17 @@ class Cube : public Plugin {
             vh = 0;
 
             sides.resize(vw);
-            sideFBuffs.resize(vw);
 
             angle = 2 * M_PI / float(vw);
             coeff = 0.5 / std::tan(angle / 2);
 
-            for(int i = 0; i < vw; i++)
-                sides[i] = sideFBuffs[i] = -1,
-                OpenGL::prepareFramebuffer(sideFBuffs[i], sides[i]);
-            mouse.action = std::bind(std::mem_fn(&Cube::mouseMoved), this);
-            core->addHook(&mouse);
+            updateUniforms();
+        }
 
-            renderer = std::bind(std::mem_fn(&Cube::Render), this);
+        void finiGL() {
+            glDeleteBuffers(1, &vbo);
+            glDeleteVertexArrays(1, &vao);
+            glDeleteProgram(program);
         }
 
         void Initiate(Context *ctx) {
@@ -222,6 +231,10 @@ class Cube : public Plugin {
                 return;
             }
 
+            gl.acquire();
+            core->viewportCache->acquire();
+            core->scheduleRedraw();
+
             GetTuple(vx, vy, core->getWorkspace());
 
             /* important: core uses vx = col vy = row */
@@ -241,13 +254,13 @@ class Cube : public Plugin {
         }
 
         void Render() {
-            glClearColor(bg.r, bg.g, bg.b, 0.0f);
+            glClearColor(bg->r, bg->g, bg->b, 0.0f);
             glClear(GL_COLOR_BUFFER_BIT|GL_DEPTH_BUFFER_BIT);
 
-            for(int i = 0; i < sides.size(); i++) {
-                core->getViewportTexture(std::make_tuple(i, vy),
-                        sideFBuffs[i], sides[i]);
-            }
+            /* sides which haven't changed are not rendered again */
+            for(int i = 0; i < sides.size(); i++)
+                sides[i] = core->viewportCache->getTexture(
+                        std::make_tuple(i, vy));
 
             glUseProgram(program);
             glEnable(GL_DEPTH_TEST);
@@ -300,6 +313,8 @@ class Cube : public Plugin {
             zoomIn.disable();
             zoomOut.disable();
             core->deactivateOwner(owner);
+            core->viewportCache->unref();
+            gl.unref();
 
             auto size = sides.size();
 
@@ -312,29 +327,38 @@ class Cube : public Plugin {
 
             int nvx = (vx + (dvx % size) + size) % size;
             core->switchWorkspace(std::make_tuple(nvx, vy));
+            /* the screen still shows the cube */
+            core->dmg = core->getMaximisedRegion();
         }
 
         void mouseMoved() {
             GetTuple(mx, my, core->getMouseCoord());
             int xdiff = mx - px;
             int ydiff = my - py;
-            offset += xdiff * Velocity;
-            offsetVert += ydiff * VVelocity;
+            /* damage on the viewports redraws the cube by itself */
+            if(!xdiff && !ydiff)
+                return;
+
+            offset += xdiff * *Velocity;
+            offsetVert += ydiff * *VVelocity;
             px = mx, py = my;
+            core->scheduleRedraw();
         }
 
         void onScrollEvent(Context *ctx) {
             auto xev = ctx->xev;
             if(xev.xbutton.button == zoomIn.button)
-                zoomFactor -= ZVelocity;
+                zoomFactor -= *ZVelocity;
             if(xev.xbutton.button == zoomOut.button)
-                zoomFactor += ZVelocity;
+                zoomFactor += *ZVelocity;
 
-            if(zoomFactor <= ZVelocity)
-                zoomFactor = ZVelocity;
+            if(zoomFactor <= *ZVelocity)
+                zoomFactor = *ZVelocity;
 
             if(zoomFactor > MaxFactor)
                 zoomFactor = MaxFactor;
+
+            core->scheduleRedraw();
         }
 };
 
@@ -35,6 +35,9 @@ namespace {
 class Commands: public Plugin {
     std::unordered_map<std::string, KeyBinding> commands;
 
+    Option<string> commandOpts[NUMBER_COMMANDS];
+    Option<Key> bindingOpts[NUMBER_COMMANDS];
+
     public:
     void initOwnership() {
         owner->name = "command";
@@ -42,31 +45,37 @@ class Commands: public Plugin {
     }
 
     void updateConfiguration() {
-        using namespace std::placeholders;
-
-        for(int i = 1; i <= NUMBER_COMMANDS; i++) {
-            auto str1 =
-                getStringFromCommandNumber(i, TYPE_COMMAND);
-            auto str2 =
-                getStringFromCommandNumber(i, TYPE_BINDING);
-
-            auto com = *options[str1]->data.sval;
+        std::unordered_set<std::string> current;
+        for(int i = 0; i < NUMBER_COMMANDS; i++) {
+            auto com = *commandOpts[i];
             if(com == "")
                 continue;
 
-            auto key = *options[str2]->data.key;
+            auto key = *bindingOpts[i];
             if(key.mod == 0 && key.key == 0)
                 continue;
 
+            /* the binding is dispatched only for its own key,
+             * so it can just run its command */
             commands[com].action = std::bind(
                     std::mem_fn(&Commands::onCommandActivated),
-                    this, _1);
+                    this, com);
             commands[com].type   = BindingTypePress;
             commands[com].key    = key.key;
             commands[com].mod    = key.mod;
             core->addKey(&commands[com], true);
+            current.insert(com);
         }
 
+        /* remove commands which are no longer in the config */
+        auto it = commands.begin();
+        while(it != commands.end()) {
+            if(current.find(it->first) == current.end())
+                core->remKey(it->second.id),
+                it = commands.erase(it);
+            else
+                ++it;
+        }
     }
     void init() {
         for(int i = 1; i <= NUMBER_COMMANDS; i++) {
@@ -75,17 +84,13 @@ class Commands: public Plugin {
             auto str2 =
                 getStringFromCommandNumber(i, TYPE_BINDING);
 
-            options.insert(newStringOption(str1, ""));
-            options.insert(newKeyOption(str2, Key{0, 0}));
+            commandOpts[i - 1] = addOption(str1, "");
+            bindingOpts[i - 1] = addOption(str2, Key{0, 0});
         }
     }
 
-    void onCommandActivated(Context *ctx){
-        auto xev = ctx->xev.xkey;
-
-        for(auto com : commands)
-            if(core->checkKey(&com.second, xev))
-                core->run(com.first.c_str());
+    void onCommandActivated(std::string command) {
+        core->run(command.c_str());
     }
 };
 
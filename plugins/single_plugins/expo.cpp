@@ -1,13 +1,11 @@
 #include <core.hpp>
+#include <opengl.hpp>
 
-// TODO: do not just hack window scaling/offsetting,
-// but fetch each viewport independently
+SignalID scaleChangedSignal;
 
 void triggerScaleChange(int scX, int scY) {
-        SignalListenerData sigData;
-        sigData.push_back(&scX);
-        sigData.push_back(&scY);
-        core->triggerSignal("screen-scale-changed", sigData);
+        ScaleChangedSignal data(scX, scY);
+        core->triggerSignal(scaleChangedSignal, data);
 }
 
 class Expo : public Plugin {
@@ -26,21 +24,26 @@ class Expo : public Plugin {
         float stepoffX, stepoffY, stepsclX, stepsclY;
 
         Hook hook;
+        /* draws the viewport textures, so only
+         * viewports which change are rendered again */
+        RenderHook renderer;
         bool active;
         std::function<FireWindow(int, int)> save; // used to restore
 
-        Key toggleKey;
+        Option<int> duration;
+        Option<Key> toggleKey;
     public:
     void updateConfiguration() {
-        expostep = getSteps(options["duration"]->data.ival);
+        expostep = getSteps(*duration);
 
-        toggleKey = *options["activate"]->data.key;
-        if(toggleKey.key == 0)
+        if(toggleKey->key == 0) {
+            toggle.disable();
             return;
+        }
 
         using namespace std::placeholders;
-        toggle.key = toggleKey.key;
-        toggle.mod = toggleKey.mod;
+        toggle.key = toggleKey->key;
+        toggle.mod = toggleKey->mod;
         toggle.action = std::bind(std::mem_fn(&Expo::Toggle), this, _1);
         core->addKey(&toggle, true);
 
@@ -60,12 +63,14 @@ class Expo : public Plugin {
 
         hook.action = std::bind(std::mem_fn(&Expo::zoom), this);
         core->addHook(&hook);
+
+        renderer = std::bind(std::mem_fn(&Expo::render), this);
     }
 
     void init() {
-        options.insert(newIntOption("duration", 1000));
-        options.insert(newKeyOption("activate", Key{0, 0}));
-        core->addSignal("screen-scale-changed");
+        duration  = addOption("duration", 1000);
+        toggleKey = addOption("activate", Key{0, 0});
+        scaleChangedSignal = core->addSignal("screen-scale-changed");
         active = false;
 
     }
@@ -127,10 +132,9 @@ class Expo : public Plugin {
     }
 
     void finalizeZoom() {
-        Transform::gtrs = glm::translate(glm::mat4(),
-                glm::vec3(offXtarget, offYtarget, 0.f));
-        Transform::gscl = glm::scale(glm::mat4(),
-                glm::vec3(sclXtarget, sclYtarget, 0.f));
+        offXcurrent = offXtarget, offYcurrent = offYtarget;
+        sclXcurrent = sclXtarget, sclYcurrent = sclYtarget;
+        core->scheduleRedraw();
     }
 
     void Toggle(Context *ctx) {
@@ -140,6 +144,15 @@ class Expo : public Plugin {
            if(!core->activateOwner(owner))
                 return;
 
+            /* still zooming out, the renderer is ours */
+            if(!hook.getState()) {
+                if(!core->setRenderer(renderer)) {
+                    core->deactivateOwner(owner);
+                    return;
+                }
+                core->viewportCache->acquire();
+            }
+
             press.enable();
             release.enable();
             owner->grab();
@@ -151,7 +164,6 @@ class Expo : public Plugin {
 
             hook.enable();
 
-            core->setRedrawEverything(true);
             stepNum = expostep;
             recalc();
 
@@ -169,10 +181,8 @@ class Expo : public Plugin {
             core->deactivateOwner(owner);
             triggerScaleChange(1, 1);
 
-            if(hook.getState()) {
-                core->setRedrawEverything(false);
+            if(hook.getState())
                 hook.disable();
-            }
             hook.enable();
             stepNum = expostep;
 
@@ -202,24 +212,52 @@ class Expo : public Plugin {
             offYcurrent += stepoffY;
             sclYcurrent += stepsclY;
             sclXcurrent += stepsclX;
-
-            Transform::gtrs = glm::translate(glm::mat4(),
-                    glm::vec3(offXcurrent, offYcurrent, 0.f));
-            Transform::gscl = glm::scale(glm::mat4(),
-                    glm::vec3(sclXcurrent, sclYcurrent, 0.f));
+            core->scheduleRedraw();
         }
         else {
             finalizeZoom();
             hook.disable();
             if(!active) {
-                output = core->getMaximisedRegion();
-                core->setRedrawEverything(false);
+                core->setDefaultRenderer();
+                core->viewportCache->unref();
                 core->dmg = core->getMaximisedRegion();
             }
 
         }
     }
 
+    void render() {
+        GetTuple(vx, vy, core->getWorkspace());
+        GetTuple(vw, vh, core->getWorksize());
+        GetTuple(sw, sh, core->getScreenSize());
+
+        /* this changes the bound framebuffer,
+         * so it is done before drawing */
+        for(int j = 0; j < vh; j++)
+            for(int i = 0; i < vw; i++)
+                core->viewportCache->getTexture(std::make_tuple(i, j));
+
+        OpenGL::useDefaultProgram();
+        OpenGL::preStage();
+        glScissor(0, 0, sw, sh);
+        glClear(GL_COLOR_BUFFER_BIT);
+
+        glm::mat4 zoom = glm::translate(glm::mat4(),
+                glm::vec3(offXcurrent, offYcurrent, 0.f));
+        zoom = zoom * glm::scale(glm::mat4(),
+                glm::vec3(sclXcurrent, sclYcurrent, 0.f));
+
+        /* placed like the windows on them would be */
+        for(int j = 0; j < vh; j++)
+            for(int i = 0; i < vw; i++)
+                core->viewportCache->draw(std::make_tuple(i, j),
+                        zoom * glm::translate(glm::mat4(),
+                            glm::vec3(2 * (i - vx), 2 * (vy - j), 0.f)));
+
+        core->afterEffects();
+        OpenGL::endStage();
+    }
+
     FireWindow findWindow(int px, int py) {
         GetTuple(w, h, core->getScreenSize());
         GetTuple(vw, vh, core->getWorksize());
@@ -24,6 +24,7 @@ class Grid : public Plugin {
     KeyCode codes[10];
 
     Hook rnd;
+    Option<int> duration;
     int steps;
     int curstep;
     GridWindow currentWin;
@@ -33,7 +34,7 @@ class Grid : public Plugin {
     }
 
     void init() {
-        options.insert(newIntOption("duration", 200));
+        duration = addOption("duration", 200);
 
         codes[1] = XKeysymToKeycode(core->d, XK_KP_End);
         codes[2] = XKeysymToKeycode(core->d, XK_KP_Down);
@@ -65,7 +66,7 @@ class Grid : public Plugin {
     }
 
     void updateConfiguration() {
-        steps = getSteps(options["duration"]->data.ival);
+        steps = getSteps(*duration);
     }
 
     void step() {
@@ -106,18 +107,18 @@ class Grid : public Plugin {
             glm::translate(glm::mat4(), glm::vec3(-offx, offy, 0));
         currentWin.win->transform.scalation =
             glm::scale(glm::mat4(), glm::vec3(sclx, scly, 0));
+        currentWin.win->damageTransformed();
 
         curstep++;
         if(curstep == steps) {
             currentWin.win->transform.translation = glm::mat4();
             currentWin.win->transform.scalation = glm::mat4();
+            currentWin.win->damageTransformed();
 
             currentWin.win->move(currentWin.size.x, currentWin.size.y);
             currentWin.win->resize(currentWin.size.width,
                     currentWin.size.height);
 
-            core->setRedrawEverything(false);
-            core->dmg = core->getMaximisedRegion();
             rnd.disable();
         }
     }
@@ -195,7 +196,6 @@ class Grid : public Plugin {
         currentWin.size.height = h;
         curstep = 0;
         rnd.enable();
-        core->setRedrawEverything(true);
     }
 };
 
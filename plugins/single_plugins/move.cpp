@@ -11,7 +11,7 @@ class Move : public Plugin {
 
         int scX = 1, scY = 1;
 
-        Button iniButton;
+        Option<Button> iniButton;
 
     public:
         void initOwnership() {
@@ -19,31 +19,31 @@ class Move : public Plugin {
             owner->compatAll = true;
         }
         void updateConfiguration() {
-
-            iniButton = *options["activate"]->data.but;
-            if(iniButton.button == 0)
+            if(iniButton->button == 0) {
+                press.disable();
                 return;
+            }
 
             hook.action = std::bind(std::mem_fn(&Move::Intermediate), this);
             core->addHook(&hook);
 
             using namespace std::placeholders;
             press.type   = BindingTypePress;
-            press.mod    = iniButton.mod;
-            press.button = iniButton.button;
+            press.mod    = iniButton->mod;
+            press.button = iniButton->button;
             press.action = std::bind(std::mem_fn(&Move::Initiate), this, _1);
             core->addBut(&press, true);
 
             release.type   = BindingTypeRelease;
             release.mod    = AnyModifier;
-            release.button = iniButton.button;
+            release.button = iniButton->button;
             release.action = std::bind(std::mem_fn(&Move::Terminate), this, _1);
             core->addBut(&release, false);
         }
 
         void init() {
             using namespace std::placeholders;
-            options.insert(newButtonOption("activate", Button{0, 0}));
+            iniButton = addOption("activate", Button{0, 0});
             sigScl.action = std::bind(std::mem_fn(&Move::onScaleChanged), this, _1);
             core->connectSignal("screen-scale-changed", &sigScl);
         }
@@ -68,7 +68,6 @@ class Move : public Plugin {
 
             this->sx = xev.x_root;
             this->sy = xev.y_root;
-            core->setRedrawEverything(true);
         }
 
         void Terminate(Context *ctx) {
@@ -78,6 +77,7 @@ class Move : public Plugin {
 
             auto xev = ctx->xev.xbutton;
             win->transform.translation = glm::mat4();
+            win->damageTransformed();
 
             int dx = (xev.x_root - sx) * scX;
             int dy = (xev.y_root - sy) * scY;
@@ -86,7 +86,6 @@ class Move : public Plugin {
             int ny = win->attrib.y + dy;
 
             win->move(nx, ny);
-            core->setRedrawEverything(false);
 
             core->focusWindow(win);
             win->addDamage();
@@ -101,11 +100,13 @@ class Move : public Plugin {
                             float(cmx - sx) / float(w / 2.0),
                             float(sy - cmy) / float(h / 2.0),
                             0.f));
+            win->damageTransformed();
         }
 
-        void onScaleChanged(SignalListenerData data) {
-            scX = *(int*)data[0];
-            scY = *(int*)data[1];
+        void onScaleChanged(SignalData &data) {
+            auto &d = static_cast<ScaleChangedSignal&>(data);
+            scX = d.scX;
+            scY = d.scY;
         }
 };
 
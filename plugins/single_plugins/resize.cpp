@@ -8,7 +8,7 @@ class Resize : public Plugin {
 
         int scX = 1, scY = 1;
         SignalListener sigScl;
-        Button iniButton;
+        Option<Button> iniButton;
 
     private:
         ButtonBinding press;
@@ -21,29 +21,30 @@ class Resize : public Plugin {
         owner->compatAll = true;
     }
     void updateConfiguration(){
-        iniButton = *options["activate"]->data.but;
-        if(iniButton.button == 0)
+        if(iniButton->button == 0) {
+            press.disable();
             return;
+        }
 
         using namespace std::placeholders;
         hook.action = std::bind(std::mem_fn(&Resize::Intermediate), this);
         core->addHook(&hook);
         press.type   = BindingTypePress;
-        press.mod    = iniButton.mod;
-        press.button = iniButton.button;
+        press.mod    = iniButton->mod;
+        press.button = iniButton->button;
         press.action = std::bind(std::mem_fn(&Resize::Initiate), this, _1);
         core->addBut(&press, true);
 
 
         release.type   = BindingTypeRelease;
         release.mod    = AnyModifier;
-        release.button = iniButton.button;
+        release.button = iniButton->button;
         release.action = std::bind(std::mem_fn(&Resize::Terminate), this,_1);
         core->addBut(&release, false);
     }
 
     void init() {
-        options.insert(newButtonOption("activate", Button{0, 0}));
+        iniButton = addOption("activate", Button{0, 0});
         using namespace std::placeholders;
         sigScl.action = std::bind(std::mem_fn(&Resize::onScaleChanged), this, _1);
         core->connectSignal("screen-scale-changed", &sigScl);
@@ -141,9 +142,10 @@ class Resize : public Plugin {
             glm::scale(glm::mat4(), glm::vec3(kW, kH, 1.f));
     }
 
-    void onScaleChanged(SignalListenerData data) {
-        scX = *(int*)data[0];
-        scY = *(int*)data[1];
+    void onScaleChanged(SignalData &data) {
+        auto &d = static_cast<ScaleChangedSignal&>(data);
+        scX = d.scX;
+        scY = d.scY;
     }
 };
 
@@ -43,7 +43,8 @@ class ATSwitcher : public Plugin {
     KeyBinding backward;
     KeyBinding terminate;
 
-    Key actKey;
+    Option<int> duration, initDuration;
+    Option<Key> actKey;
     std::vector<FireWindow> windows;
 
 #define MAXDIRS 10
@@ -78,18 +79,19 @@ class ATSwitcher : public Plugin {
     }
 
     void updateConfiguration() {
-        steps = getSteps(options["duration"]->data.ival);
-        initsteps = getSteps(options["init"]->data.ival);
+        steps = getSteps(*duration);
+        initsteps = getSteps(*initDuration);
 
-        actKey = *options["activate"]->data.key;
-        if(actKey.key == 0)
+        if(actKey->key == 0) {
+            initiate.disable();
             return;
+        }
 
         using namespace std::placeholders;
 
         active = false;
-        initiate.mod = actKey.mod;
-        initiate.key = actKey.key;
+        initiate.mod = actKey->mod;
+        initiate.key = actKey->key;
         initiate.type = BindingTypePress;
         initiate.action =
             std::bind(std::mem_fn(&ATSwitcher::handleKey), this, _1);
@@ -124,9 +126,9 @@ class ATSwitcher : public Plugin {
     }
 
     void init() {
-        options.insert(newIntOption("duration", 1000));
-        options.insert(newIntOption("init", 1000));
-        options.insert(newKeyOption("activate", Key{0, 0}));
+        duration     = addOption("duration", 1000);
+        initDuration = addOption("init", 1000);
+        actKey       = addOption("activate", Key{0, 0});
     }
 
     void handleKey(Context *ctx) {
@@ -200,7 +202,7 @@ class ATSwitcher : public Plugin {
             ++it;
         }
 
-        for(auto w : windows) {
+        for(const auto &w : windows) {
             WinAttrib wia;
             wia.win = w;
 
@@ -249,9 +251,9 @@ class ATSwitcher : public Plugin {
         if(background)
             background->transform.color = glm::vec4(c, c, c, 1.0);
 
-        for(auto attrib : winsToMove) {
+        for(const auto &attrib : winsToMove) {
             attrib.win->transform.translation =
-                glm::translate(attrib.win->transform.translation,
+                glm::translate(attrib.win->transform.translation.get(),
                         glm::vec3(attrib.offX / float(initsteps),
                                   attrib.offY / float(initsteps), 0));
 
@@ -262,8 +264,9 @@ class ATSwitcher : public Plugin {
         curstep++;
         if(curstep == initsteps) {
             winsToMove.clear();
-            for(auto w : this->windows) {
+            for(const auto &w : this->windows) {
                 w->norender = true;
+                w->markDirty();
             }
             ini.disable();
             rnd.enable();
@@ -279,6 +282,9 @@ class ATSwitcher : public Plugin {
             windows[index]->norender = false;
             windows[next ]->norender = false;
             windows[prev ]->norender = false;
+            windows[index]->markDirty();
+            windows[next ]->markDirty();
+            windows[prev ]->markDirty();
 
             WinAttrib prv;
             prv.win = windows[prev];
@@ -335,7 +341,7 @@ class ATSwitcher : public Plugin {
     }
 
     void exitHook() {
-        for(auto attr : winsToMove) {
+        for(const auto &attr : winsToMove) {
             if(attr.scale) {
                 auto c = (attr.scaleEnd * float(curstep) +
                         attr.scaleStart * float(initsteps - curstep))
@@ -345,13 +351,13 @@ class ATSwitcher : public Plugin {
             }
 
             attr.win->transform.translation = glm::translate(
-                    attr.win->transform.translation,
+                    attr.win->transform.translation.get(),
                     glm::vec3(attr.offX / initsteps,
                               attr.offY / initsteps,
                               attr.offZ / initsteps));
 
             attr.win->transform.rotation = glm::rotate(
-                    attr.win->transform.rotation,
+                    attr.win->transform.rotation.get(),
                     attr.rotateAngle / initsteps,
                     glm::vec3(0, 1, 0));
         }
@@ -359,8 +365,9 @@ class ATSwitcher : public Plugin {
         if(curstep == initsteps) {
             exit.disable();
             block = false;
-            for(auto w : windows)
+            for(const auto &w : windows)
                 w->norender = false,
+                w->markDirty(),
                 w->transform.scalation   =
                 w->transform.translation =
                 w->transform.rotation    = glm::mat4(),
@@ -387,14 +394,14 @@ class ATSwitcher : public Plugin {
 
 
     void step() {
-        for(auto attr : winsToMove) {
+        for(const auto &attr : winsToMove) {
             attr.win->transform.translation =
-                glm::translate(attr.win->transform.translation,
+                glm::translate(attr.win->transform.translation.get(),
                 glm::vec3(attr.offX / float(steps), 0.f,
                           attr.offZ / float(steps)));
 
             attr.win->transform.rotation =
-                glm::rotate(attr.win->transform.rotation,
+                glm::rotate(attr.win->transform.rotation.get(),
                         attr.rotateAngle / float(steps),
                         glm::vec3(0, 1, 0));
 
@@ -438,6 +445,9 @@ class ATSwitcher : public Plugin {
         windows[index]->norender = false;
         windows[next ]->norender = false;
         windows[prev ]->norender = false;
+        windows[index]->markDirty();
+        windows[next ]->markDirty();
+        windows[prev ]->markDirty();
 
         float factor = 1;
 
@@ -486,6 +496,9 @@ class ATSwitcher : public Plugin {
         windows[index]->norender = true;
         windows[next ]->norender = true;
         windows[prev ]->norender = true;
+        windows[index]->markDirty();
+        windows[next ]->markDirty();
+        windows[prev ]->markDirty();
 
         if(prev == next)
             return;
@@ -1,4 +1,5 @@
 #include <core.hpp>
+#include <opengl.hpp>
 
 class VSwitch : public Plugin {
     private:
@@ -7,11 +8,17 @@ class VSwitch : public Plugin {
 
         Hook hook;
         int stepNum;
+        Option<int> duration;
         int vstep;
         int dirx, diry;
         int dx, dy;
         int nx, ny;
+        float offx, offy; // of the current viewport, like Transform::gtrs
         std::queue<std::tuple<int, int> >dirs; // series of moves we have to do
+
+        /* the slide is drawn from the viewport textures,
+         * so only viewports which change are rendered again */
+        RenderHook renderer;
     public:
 
     void initOwnership() {
@@ -20,7 +27,7 @@ class VSwitch : public Plugin {
     }
 
     void updateConfiguration() {
-        vstep = getSteps(options["duration"]->data.ival);
+        vstep = getSteps(*duration);
     }
 
     void beginSwitch() {
@@ -43,22 +50,7 @@ class VSwitch : public Plugin {
 
         dx = (vx - nx) * sw;
         dy = (vy - ny) * sh;
-
-        int tlx1 = 0;
-        int tly1 = 0;
-        int brx1 = sw;
-        int bry1 = sh;
-
-        int tlx2 = -dx;
-        int tly2 = -dy;
-        int brx2 = tlx2 + sw;
-        int bry2 = tly2 + sh;
-
-        core->setRedrawEverything(true);
-        output = core->getRegionFromRect(std::min(tlx1, tlx2),
-                std::min(tly1, tly2),
-                std::max(brx1, brx2),
-                std::max(bry1, bry2));
+        offx = offy = 0;
 
         core->activateOwner(owner);
         stepNum = 0;
@@ -66,10 +58,15 @@ class VSwitch : public Plugin {
 
 #define MAXDIRS 6
     void insertNextDirection(int ddx, int ddy) {
-        if(!hook.getState())
-            hook.enable(),
-            dirs.push(std::make_tuple(ddx, ddy)),
+        if(!hook.getState()) {
+            if(!core->setRenderer(renderer))
+                return;
+
+            core->viewportCache->acquire();
+            hook.enable();
+            dirs.push(std::make_tuple(ddx, ddy));
             beginSwitch();
+        }
         else if(dirs.size() < MAXDIRS)
             dirs.push(std::make_tuple(ddx, ddy));
     }
@@ -92,19 +89,24 @@ class VSwitch : public Plugin {
             insertNextDirection(0, -1);
         if(xev.keycode == switchWorkspaceBindings[3])
             insertNextDirection(0,  1);
+
+        if(!hook.getState())
+            core->deactivateOwner(owner);
     }
 
     void Step() {
         GetTuple(w, h, core->getScreenSize());
 
         if(stepNum == vstep){
-            Transform::gtrs = glm::mat4();
             core->switchWorkspace(std::make_tuple(nx, ny));
-            core->setRedrawEverything(false);
 
             if(dirs.size() == 0) {
                 hook.disable();
+                core->setDefaultRenderer();
+                core->viewportCache->unref();
                 core->deactivateOwner(owner);
+                /* the screen still shows the slide */
+                core->dmg = core->getMaximisedRegion();
             }
             else
                 beginSwitch();
@@ -120,13 +122,53 @@ class VSwitch : public Plugin {
         if(!diry)
             offy = 0;
 
-        Transform::gtrs = glm::translate(glm::mat4(), glm::vec3(offx, offy, 0.0));
+        this->offx = offx, this->offy = offy;
+        core->scheduleRedraw();
+    }
+
+    /* calls action for the viewports on screen during the slide,
+     * with their offset */
+    template<class T> void forVisibleViewports(T action) {
+        GetTuple(vx, vy, core->getWorkspace());
+        GetTuple(vw, vh, core->getWorksize());
+
+        for(int j = 0; j < vh; j++) {
+            for(int i = 0; i < vw; i++) {
+                float ox = offx + 2.f * (i - vx);
+                float oy = offy - 2.f * (j - vy);
+
+                if(std::abs(ox) < 2.f && std::abs(oy) < 2.f)
+                    action(std::make_tuple(i, j), ox, oy);
+            }
+        }
+    }
+
+    void Render() {
+        /* textures are updated before drawing, this
+         * changes the bound framebuffer */
+        forVisibleViewports([] (std::tuple<int, int> vp, float, float) {
+                core->viewportCache->getTexture(vp);
+            });
+
+        GetTuple(sw, sh, core->getScreenSize());
+        OpenGL::useDefaultProgram();
+        OpenGL::preStage();
+        glScissor(0, 0, sw, sh);
+        glClear(GL_COLOR_BUFFER_BIT);
+
+        forVisibleViewports([] (std::tuple<int, int> vp, float ox, float oy) {
+                core->viewportCache->draw(vp, glm::translate(glm::mat4(),
+                            glm::vec3(ox, oy, 0.f)));
+            });
+
+        core->afterEffects();
+        OpenGL::endStage();
     }
 
     void init() {
         using namespace std::placeholders;
 
-        options.insert(newIntOption("duration", 500));
+        duration = addOption("duration", 500);
 
         switchWorkspaceBindings[0] = XKeysymToKeycode(core->d, XK_h);
         switchWorkspaceBindings[1] = XKeysymToKeycode(core->d, XK_l);
@@ -143,6 +185,8 @@ class VSwitch : public Plugin {
 
         hook.action = std::bind(std::mem_fn(&VSwitch::Step), this);
         core->addHook(&hook);
+
+        renderer = std::bind(std::mem_fn(&VSwitch::Render), this);
     }
 };
 extern "C" {
@@ -1,7 +1,6 @@
 #include <config.hpp>
 #include <core.hpp>
-
-#define copyInto(x,y) std::memcpy(&(y), &(x), sizeof((y)))
+#include <sys/inotify.h>
 
 #ifdef log
 #undef log
@@ -24,7 +23,7 @@ namespace {
     /* self-explanatory */
     void setDefaultOptions(PluginPtr p) {
         for(auto o : p->options)
-            copyInto(o.second->def, o.second->data);
+            o.second->data = o.second->def;
     }
 
     /* used for parsing of different values */
@@ -182,10 +181,11 @@ Config::Config(std::string path) {
 
 Config::Config() : Config("~/.config/firerc") { }
 
-void Config::readConfig() {
+bool Config::readConfig() {
     if(blocked)
-        return;
+        return false;
 
+    bool ok = true;
     std::string line;
     std::string currentPluginName = "";
     std::string option, value;
@@ -196,6 +196,12 @@ void Config::readConfig() {
             continue;
 
         if(line[0] == '[') {
+            if(line.back() != ']') {
+                std::cout << "Warning - Garbage in config" << std::endl;
+                ok = false;
+                continue;
+            }
+
             currentPluginName =
                 line.substr(1, line.length() - 2);
             continue;
@@ -204,6 +210,7 @@ void Config::readConfig() {
         auto pos = line.find("=");
         if(pos == std::string::npos) {
             std::cout << "Warning - Garbage in config" << std::endl;
+            ok = false;
             continue;
         }
 
@@ -213,12 +220,78 @@ void Config::readConfig() {
         value  = trim(line.substr(pos + 1, line.length() - pos));
         tree[currentPluginName][realOption] = Option{type, value};
     }
+
+    return ok;
 }
 
 void Config::reset() {
     stream.close();
     tree.clear();
     stream.open(path, std::ios::in | std::ios::out);
+    blocked = !stream.is_open();
+}
+
+bool Config::reload(std::unordered_set<std::string> &changed) {
+    auto old = std::move(tree);
+    reset();
+
+    /* probably a half-written file, it will be read again
+     * when it changes, until then nothing changes */
+    if(!readConfig()) {
+        tree = std::move(old);
+        return false;
+    }
+
+    for(auto &section : tree) {
+        auto it = old.find(section.first);
+        if(it == old.end() || it->second != section.second)
+            changed.insert(section.first);
+    }
+
+    /* removed sections fall back to defaults */
+    for(auto &section : old)
+        if(tree.find(section.first) == tree.end())
+            changed.insert(section.first);
+
+    return true;
+}
+
+int Config::startWatching() {
+    inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if(inotifyFd < 0) {
+        log << "Failed to watch config file" << std::endl;
+        return -1;
+    }
+
+    /* watch the directory, because editors usually
+     * replace the file instead of writing to it */
+    auto pos = path.find_last_of('/');
+    auto dir = pos == std::string::npos ? "." : path.substr(0, pos);
+
+    inotify_add_watch(inotifyFd, dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+    return inotifyFd;
+}
+
+bool Config::checkChanged() {
+    auto pos = path.find_last_of('/');
+    auto file = pos == std::string::npos ? path : path.substr(pos + 1);
+
+    char buf[4096]
+        __attribute__ ((aligned(__alignof__(struct inotify_event))));
+
+    bool changed = false;
+    ssize_t len;
+    while((len = read(inotifyFd, buf, sizeof(buf))) > 0) {
+        for(char *ptr = buf; ptr < buf + len;) {
+            auto event = (inotify_event*) ptr;
+            if(event->len && file == event->name)
+                changed = true;
+
+            ptr += sizeof(inotify_event) + event->len;
+        }
+    }
+
+    return changed;
 }
 
 void Config::setOptionsForPlugin(PluginPtr p) {
@@ -234,54 +307,46 @@ void Config::setOptionsForPlugin(PluginPtr p) {
         auto it = tree[name].find(oname);
 
         if(it == tree[name].end()) {
-            copyInto(p->options[oname]->def,
-                    p->options[oname]->data);
+            option.second->data = option.second->def;
             continue;
         }
 
         auto opt = it->second;
-        auto reqType = p->options[oname]->type;
+        auto reqType = option.second->type;
 
         if(!isValidToRead(opt.type, reqType)) {
             std::cout << "[EE] Type mismatch: \n";
             std::cout << "\t Plugin name:" << name
                 << " Option name: " << oname << std::endl;
 
-            copyInto(p->options[oname]->def,
-                    p->options[oname]->data);
+            option.second->data = option.second->def;
             continue;
         }
 
         auto data = opt.value;
+        auto &value = option.second->data;
 
         switch(reqType) {
             case DataTypeInt:
-                p->options[oname]->data.ival =
-                    readValue<int>(data);
+                value.ival  = readValue<int>(data);
                 break;
             case DataTypeFloat:
-                p->options[oname]->data.fval =
-                    readValue<float>(data);
+                value.fval  = readValue<float>(data);
                 break;
             case DataTypeBool:
-                p->options[oname]->data.bval =
-                    readValue<bool>(data);
+                value.bval  = readValue<bool>(data);
                 break;
             case DataTypeString:
-                p->options[oname]->data.sval =
-                    new std::string(data);
+                value.sval  = data;
                 break;
             case DataTypeColor:
-                p->options[oname]->data.color =
-                    new Color(readValue<Color>(data));
+                value.color = readValue<Color>(data);
                 break;
             case DataTypeKey:
-                p->options[oname]->data.key =
-                    new Key(readValue<Key>(data));
+                value.key   = readValue<Key>(data);
                 break;
             case DataTypeButton:
-                p->options[oname]->data.but =
-                    new Button(readValue<Button>(data));
+                value.but   = readValue<Button>(data);
                 break;
         }
     }
@@ -13,28 +13,36 @@ int refreshrate;
 
 class CorePlugin : public Plugin {
     public:
+        Option<int> rrate, vwidth, vheight, gpuidle;
+        Option<string> background, shadersrc, pluginpath, plugins;
+
         void init() {
-            options.insert(newIntOption("rrate", 100));
-            options.insert(newIntOption("vwidth", 3));
-            options.insert(newIntOption("vheight", 3));
-            options.insert(newStringOption("background", ""));
-            options.insert(newStringOption("shadersrc", "/usr/local/share/fireman/shaders"));
-            options.insert(newStringOption("pluginpath", "/usr/local/lib/fireman/"));
-            options.insert(newStringOption("plugins", ""));
+            rrate      = addOption("rrate", 100);
+            vwidth     = addOption("vwidth", 3);
+            vheight    = addOption("vheight", 3);
+            background = addOption("background", "");
+            shadersrc  = addOption("shadersrc", "/usr/local/share/fireman/shaders");
+            pluginpath = addOption("pluginpath", "/usr/local/lib/fireman/");
+            plugins    = addOption("plugins", "");
+            gpuidle    = addOption("gpuidle", 30000);
         }
         void initOwnership() {
             owner->name = "core";
             owner->compatAll = true;
         }
         void updateConfiguration() {
-            refreshrate = options["rrate"]->data.ival;
+            refreshrate = *rrate;
         }
 };
-PluginPtr plug; // used to get core options
+std::shared_ptr<CorePlugin> plug; // used to get core options
 
 Core::Core(int vx, int vy) {
     this->vx = vx;
     this->vy = vy;
+    Transform::gviewport = glm::translate(glm::mat4(),
+            glm::vec3(-2 * vx, 2 * vy, 0));
+
+    addDefaultSignals();
 }
 
 void Core::enableInputPass(Window win) {
@@ -55,33 +63,114 @@ void Core::addExistingWindows() {
     if(size == 0)
         return;
 
-    for(int i = size - 1; i >= 0; i--)
-        if(children[i] != overlay   &&
-           children[i] != outputwin &&
-           children[i] != s0owner   &&
-           children[i] != root       )
+    /* windows saved by the previous Core (if it crashed or was
+     * restarted) are restored with their stacking, type and state */
+    std::unordered_map<Window, SavedWindow*> saved;
+    if(isStateValid())
+        for(int i = 0; i < shared->numWindows; i++)
+            saved[shared->windows[i].id] = &shared->windows[i];
+
+    /* send the requests for all windows before
+     * waiting for any reply */
+    std::vector<WindowCookies> cookies;
+    for(int i = size - 1; i >= 0; i--) {
+        if(children[i] == overlay   ||
+           children[i] == outputwin ||
+           children[i] == s0owner   ||
+           children[i] == root       )
+            continue;
+
+        auto it = saved.find(children[i]);
+        cookies.push_back(WinUtil::requestWindowInfo(children[i],
+                    it == saved.end() ? nullptr : it->second));
+    }
+
+    std::vector<FireWindow> restored;
+    for(auto &c : cookies) {
+        if(!c.saved) continue;
+
+        auto w = std::make_shared<FireWin>(c);
+        w->layer = Layer(c.saved->layer);
+        w->setViewport(c.saved->vpx, c.saved->vpy);
+        restored.push_back(w);
+    }
+
+    if(!restored.empty()) {
+        std::sort(restored.begin(), restored.end(),
+                [&saved] (FireWindow a, FireWindow b) {
+                    return saved[a->id] < saved[b->id];
+                });
+        wins->restoreWindows(restored, shared);
+
+        for(auto w : restored) {
+            auto sw = saved[w->id];
+            if(sw->transientFor)
+                w->transientFor = findWindow(sw->transientFor);
+            if(sw->leader)
+                w->leader = findWindow(sw->leader);
+            wins->updateLinks(w);
+        }
+    }
+
+    for(auto &c : cookies) {
+        if(c.saved) continue;
+
+        XCreateWindowEvent xev;
+        xev.window = c.id;
+        xev.parent = 0;
+        addWindow(xev, c);
+    }
 
-            addWindow(children[i]);
+    /* same for the attributes synced on mapping */
+    std::vector<std::tuple<FireWindow, xcb_get_window_attributes_cookie_t,
+        xcb_get_geometry_cookie_t>> mapped;
 
     for(int i = size - 1; i >= 0; i--) {
         auto w = findWindow(children[i]);
-        if(w) w->initialMapping = false,
-              mapWindow(w, false);
+        if(w) mapped.push_back(std::make_tuple(w,
+                    xcb_get_window_attributes(xconn, w->id),
+                    xcb_get_geometry(xconn, w->id)));
+    }
+
+    for(auto &m : mapped) {
+        auto w = std::get<0>(m);
+        w->initialMapping = false;
+        w->syncAttrib(std::get<1>(m), std::get<2>(m));
+        finishMapping(w);
     }
+
+    if(!restored.empty()) {
+        auto active = findWindow(shared->activeWin);
+        if(!active)
+            active = wins->getTopmostToplevel();
+        focusWindow(active);
+    }
+
+    XFree(children);
 }
 
 void Core::init() {
+    auto phaseStart = startTime = getTimeMs();
+    auto endPhase = [&phaseStart] (const char *phase) {
+        auto now = getTimeMs();
+        std::cout << "[DD] Startup: " << phase << " took "
+            << now - phaseStart << "ms" << std::endl;
+        phaseStart = now;
+    };
+
     d = XOpenDisplay(NULL);
 
     if ( d == nullptr )
         std::cout << "Failed to open display!" << std::endl;
 
-    XSynchronize(d, 1);
-
+    xconn = XGetXCBConnection(d);
     root = DefaultRootWindow(d);
     fd.fd = ConnectionNumber(d);
     fd.events = POLLIN;
 
+    configFd.fd = config->startWatching();
+    configFd.events = POLLIN;
+
     XSelectInput(d, root, SubstructureNotifyMask);
 
     XWindowAttributes xwa;
@@ -100,10 +189,13 @@ void Core::init() {
              ButtonPressMask          | ButtonReleaseMask        |
              FocusChangeMask          | ExposureMask             );
 
+    /* the error (if any) must arrive before we check */
+    XSync(d, False);
     if(wmDetected)
        std::cout << "Another WM already running!\n", std::exit(-1);
 
     wins = new WinStack();
+    viewportCache = new ViewportCache();
 
     using namespace std::placeholders;
     this->getWindowAtPoint =
@@ -132,8 +224,11 @@ void Core::init() {
     a = XInternAtom (d, "_NET_WM_CM_S0", False);
     XSetSelectionOwner (d, a, s0owner, 0);
 
-    run("setxkbmap -model pc104 -layout us,bg -variant ,phonetic -option grp:alt_shift_toggle");
+    endPhase("X connection");
 
+    runAfterFirstFrame([=] () {
+        run("setxkbmap -model pc104 -layout us,bg -variant ,phonetic -option grp:alt_shift_toggle");
+    });
 
     initDefaultPlugins();
 
@@ -144,45 +239,112 @@ void Core::init() {
     config->setOptionsForPlugin(plug);
     plug->updateConfiguration();
 
-    vwidth = plug->options["vwidth"]->data.ival;
-    vheight= plug->options["vheight"]->data.ival;
+    vwidth = *plug->vwidth;
+    vheight= *plug->vheight;
+    wins->updateGrid();
 
     loadDynamicPlugins();
+    endPhase("loading plugins");
 
     WinUtil::init();
     GLXUtils::initGLX();
-    OpenGL::initOpenGL((*plug->options["shadersrc"]->data.sval).c_str());
-    core->setBackground((*plug->options["background"]->data.sval).c_str());
+    OpenGL::initOpenGL(plug->shadersrc->c_str());
+    core->setBackground(plug->background->c_str());
+    endPhase("OpenGL init");
 
-    for(auto p : plugins) {
-        p->owner = std::make_shared<_Ownership>();
-        p->initOwnership();
-        regOwner(p->owner);
-        p->init();
-        config->setOptionsForPlugin(p);
-        p->updateConfiguration();
-    }
+    for(auto p : plugins)
+        initPlugin(p);
+    endPhase("plugin init");
 
     dmg = getMaximisedRegion();
     resetDMG = true;
 
     addExistingWindows();
+    endPhase("adding existing windows");
+
     setDefaultRenderer();
-    addDefaultSignals();
+}
+
+void Core::saveState() {
+    shared->magic = 0;
+    shared->version = StateVersion;
+    shared->vx = vx;
+    shared->vy = vy;
+    wins->saveState(shared);
+    shared->magic = StateMagic;
+
+    stateDirty = false;
+}
+
+void Core::runAfterFirstFrame(TimerCallback action) {
+    if(firstFrameDone)
+        action();
+    else
+        afterFirstFrame.push_back(action);
+}
+
+void Core::onFirstFrame() {
+    firstFrameDone = true;
+    std::cout << "[DD] Startup: first frame after "
+        << getTimeMs() - startTime << "ms" << std::endl;
+
+    if(shared->restartTime) {
+        std::cout << "[DD] Restart: first frame after "
+            << getTimeMs() - shared->restartTime << "ms" << std::endl;
+        shared->restartTime = 0;
+    }
+
+    /* actions might add new actions, they are run immediately */
+    auto actions = std::move(afterFirstFrame);
+    afterFirstFrame.clear();
+
+    auto actionsStart = getTimeMs();
+    for(auto &action : actions)
+        action();
+
+    std::cout << "[DD] Startup: deferred actions took "
+        << getTimeMs() - actionsStart << "ms" << std::endl;
 }
 
 Core::~Core(){
-    for(auto p : plugins) {
+    /* leave all windows where they belong for whoever comes next */
+    wins->forEachWindow([] (const FireWindow &w) {
+            w->syncViewport();
+        });
+
+    for(auto &p : plugins) {
         p->fini();
-        if(p->dynamic)
-            dlclose(p->handle);
+
+        /* destroy the plugin before closing its library */
+        auto dynamic = p->dynamic;
+        auto handle = p->handle;
         p.reset();
+        if(dynamic)
+            dlclose(handle);
     }
 
+    /* plugins have released their viewport textures */
+    auto &vstats = viewportCache->stats;
+    std::cout << "[DD] Viewports: " << vstats.hits << " cached, "
+        << vstats.partial << " partial, " << vstats.full
+        << " full renders" << std::endl;
+    delete viewportCache;
+
     XDestroyWindow(core->d, outputwin);
     XDestroyWindow(core->d, s0owner);
 
     XCompositeReleaseOverlayWindow(d, overlay);
+
+    std::cout << "[DD] Damage: simplified " << damageStats.simplified
+        << " times (" << damageStats.merges << " merges), "
+        << damageStats.fullDamage << " full damage fallbacks" << std::endl;
+    std::cout << "[DD] Full redraws: " << wins->cullStats.drawn
+        << " windows drawn, " << wins->cullStats.culled
+        << " off-screen windows culled" << std::endl;
+
+    /* we are going to exit, make sure everything
+     * reaches the server */
+    XSync(d, False);
 }
 
 void Core::run(const char *command) {
@@ -200,9 +362,14 @@ Context::Context(XEvent ev) : xev(ev){}
 Hook::Hook() : active(false) {}
 
 void Core::addHook(Hook *hook){
-    if(hook)
-        hook->id = nextID++,
-        hooks.push_back(hook);
+    /* plugins add their hooks in updateConfiguration(),
+     * which is called again on config reload */
+    if(!hook || std::find(hooks.begin(), hooks.end(), hook) != hooks.end())
+        return;
+
+    hook->id = nextID++;
+    hook->owner = currentOwner;
+    hooks.push_back(hook);
 }
 
 void Core::remHook(uint key) {
@@ -223,6 +390,7 @@ void Core::addEffect(EffectHook *hook){
     if(!hook) return;
 
     hook->id = nextID++;
+    hook->owner = currentOwner;
 
     if(hook->type == EFFECT_OVERLAY)
         effects.push_back(hook);
@@ -251,6 +419,111 @@ void Core::remEffect(uint key, FireWindow w) {
     }
 }
 
+uint Core::addTimer(int timeout, TimerCallback action) {
+    auto id = nextID++;
+    auto owner = currentOwner;
+    if(owner)
+        timerOwners[id] = owner;
+
+    timers.add(id, timeout, [=] () {
+        timerOwners.erase(id);
+        OwnerScope scope(owner);
+        action();
+    });
+    return id;
+}
+
+void Core::remTimer(uint id) {
+    timers.remove(id);
+    timerOwners.erase(id);
+}
+
+OwnerScope::OwnerScope(Ownership owner) {
+    previous = core->currentOwner;
+    core->currentOwner = owner;
+}
+
+OwnerScope::~OwnerScope() {
+    core->currentOwner = previous;
+}
+
+void Core::removeOwnedBy(Ownership owner) {
+    auto kit = std::remove_if(keys.begin(), keys.end(),
+            [this, owner] (KeyBinding *kb) {
+                if(kb->owner != owner)
+                    return false;
+
+                kb->disable();
+                unindexBinding(keyTable, kb);
+                return true;
+            });
+    keys.erase(kit, keys.end());
+
+    auto bit = std::remove_if(buttons.begin(), buttons.end(),
+            [this, owner] (ButtonBinding *bb) {
+                if(bb->owner != owner)
+                    return false;
+
+                bb->disable();
+                unindexBinding(pressTable, bb);
+                unindexBinding(releaseTable, bb);
+                return true;
+            });
+    buttons.erase(bit, buttons.end());
+
+    auto hit = std::remove_if(hooks.begin(), hooks.end(),
+            [owner] (Hook *hook) {
+                if(hook->owner != owner)
+                    return false;
+
+                hook->disable();
+                return true;
+            });
+    hooks.erase(hit, hooks.end());
+
+    auto eit = std::remove_if(effects.begin(), effects.end(),
+            [owner] (EffectHook *hook) {
+                if(hook->owner != owner)
+                    return false;
+
+                hook->disable();
+                return true;
+            });
+    effects.erase(eit, effects.end());
+
+    wins->forEachWindow([owner] (const FireWindow &w) {
+        auto it = w->effects.begin();
+        while(it != w->effects.end()) {
+            if(it->second->owner == owner)
+                it->second->disable(),
+                it = w->effects.erase(it);
+            else
+                ++it;
+        }
+    });
+
+    for(auto &sig : signals)
+        removeListeners(sig, [owner] (SignalListener *sigl) {
+                return sigl->owner == owner;
+            });
+
+    for(int i = 0; i < MaxDataSlots; i++)
+        if(slotUsed[i] && slotOwners[i] == owner)
+            freeDataSlot(i);
+
+    auto tit = timerOwners.begin();
+    while(tit != timerOwners.end()) {
+        if(tit->second == owner)
+            timers.remove(tit->first),
+            tit = timerOwners.erase(tit);
+        else
+            ++tit;
+    }
+
+    if(render.replaced && render.owner == owner)
+        setDefaultRenderer();
+}
+
 bool Hook::getState() { return this->active; }
 
 void Hook::enable() {
@@ -272,6 +545,7 @@ void KeyBinding::enable() {
     if(active) return;
 
     active = true;
+    grabbedKey = key, grabbedMod = mod;
     XGrabKey(core->d, key, mod, core->root,
             false, GrabModeAsync, GrabModeAsync);
 }
@@ -280,19 +554,86 @@ void KeyBinding::disable() {
     if(!active) return;
 
     active = false;
-    XUngrabKey(core->d, key, mod, core->root);
+    XUngrabKey(core->d, grabbedKey, grabbedMod, core->root);
+}
+
+void KeyBinding::regrab() {
+    if(!active || (key == grabbedKey && mod == grabbedMod))
+        return;
+
+    disable();
+    enable();
+}
+
+namespace {
+    uint64_t bindingKey(uint code, uint mod) {
+        return (uint64_t(code) << 32) | mod;
+    }
+}
+
+template<class T>
+void Core::indexBinding(BindingTable<T> &table, T *b, uint64_t key) {
+    b->tableKey = key;
+    table[key].push_back(b);
+}
+
+template<class T>
+void Core::unindexBinding(BindingTable<T> &table, T *b) {
+    auto it = table.find(b->tableKey);
+    if(it == table.end())
+        return;
+
+    auto &list = it->second;
+    list.erase(std::remove(list.begin(), list.end(), b), list.end());
+    if(list.empty())
+        table.erase(it);
+}
+
+template<class T, class F>
+void Core::dispatchBindings(BindingTable<T> &table, uint64_t key, F action) {
+    /* an action can add or remove bindings, so look
+     * the list up again instead of holding on to it */
+    for(size_t i = 0; ; i++) {
+        auto it = table.find(key);
+        if(it == table.end() || i >= it->second.size())
+            return;
+
+        auto b = it->second[i];
+        if(!b->active)
+            continue;
+
+        OwnerScope scope(b->owner);
+        if(action(b))
+            return;
+    }
 }
 
 void Core::addKey(KeyBinding *kb, bool grab) {
     if(!kb) return;
-    keys.push_back(kb);
+
+    /* adding a binding again (on config reload)
+     * only grabs it again if it changed */
+    if(std::find(keys.begin(), keys.end(), kb) == keys.end())
+        kb->id = nextID++,
+        kb->owner = currentOwner,
+        keys.push_back(kb);
+    else
+        kb->regrab(),
+        unindexBinding(keyTable, kb);
+
+    indexBinding(keyTable, kb, bindingKey(kb->key, kb->mod));
     if(grab) kb->enable();
 }
 
 void Core::remKey(uint key) {
-    auto it = std::remove_if(keys.begin(), keys.end(), [key] (KeyBinding *kb) {
-                if(kb) return kb->id == key;
-                else return true;
+    auto it = std::remove_if(keys.begin(), keys.end(), [this, key] (KeyBinding *kb) {
+                if(kb->id != key)
+                    return false;
+
+                /* the passive grab would keep swallowing the key */
+                kb->disable();
+                unindexBinding(keyTable, kb);
+                return true;
             });
 
     keys.erase(it, keys.end());
@@ -302,6 +643,7 @@ void ButtonBinding::enable() {
     if(active) return;
 
     active = true;
+    grabbedButton = button, grabbedMod = mod;
     XGrabButton(core->d, button, mod,
             core->root, false, ButtonPressMask,
             GrabModeAsync, GrabModeAsync,
@@ -312,20 +654,50 @@ void ButtonBinding::disable() {
     if(!active) return;
 
     active = false;
-    XUngrabButton(core->d, button, mod, core->root);
+    XUngrabButton(core->d, grabbedButton, grabbedMod, core->root);
+}
+
+void ButtonBinding::regrab() {
+    if(!active || (button == grabbedButton && mod == grabbedMod))
+        return;
+
+    disable();
+    enable();
+}
+
+void Core::indexButton(ButtonBinding *bb) {
+    /* release bindings match regardless of modifiers */
+    if(bb->type == BindingTypeRelease)
+        indexBinding(releaseTable, bb, bindingKey(bb->button, AnyModifier));
+    else
+        indexBinding(pressTable, bb, bindingKey(bb->button, bb->mod));
 }
 
 void Core::addBut(ButtonBinding *bb, bool grab) {
     if(!bb) return;
 
-    buttons.push_back(bb);
+    if(std::find(buttons.begin(), buttons.end(), bb) == buttons.end())
+        bb->id = nextID++,
+        bb->owner = currentOwner,
+        buttons.push_back(bb);
+    else
+        bb->regrab(),
+        unindexBinding(pressTable, bb),
+        unindexBinding(releaseTable, bb);
+
+    indexButton(bb);
     if(grab) bb->enable();
 }
 
 void Core::remBut(uint key) {
-    auto it = std::remove_if(buttons.begin(), buttons.end(), [key] (ButtonBinding *bb) {
-                if(bb) return bb->id == key;
-                else return true;
+    auto it = std::remove_if(buttons.begin(), buttons.end(), [this, key] (ButtonBinding *bb) {
+                if(bb->id != key)
+                    return false;
+
+                bb->disable();
+                unindexBinding(pressTable, bb);
+                unindexBinding(releaseTable, bb);
+                return true;
             });
     buttons.erase(it, buttons.end());
 }
@@ -378,25 +750,22 @@ void Core::afterEffects() {
         if(effect && effect->getState())
             runningEffects.push_back(effect);
 
-    for(auto effect : runningEffects)
+    for(auto effect : runningEffects) {
+        OwnerScope scope(effect->owner);
         effect->action();
+    }
 
     glUseProgram(0);
     OpenGL::useDefaultProgram();
 }
 
 void Core::defaultRenderer() {
-    XIntersectRegion(dmg, output, dmg);
+    dmg.intersect(output);
 
     OpenGL::preStage();
     wins->renderWindows();
     afterEffects();
     OpenGL::endStage();
-
-    if(resetDMG)
-        XDestroyRegion(dmg),
-        dmg = getRegionFromRect(0, 0, 0, 0),
-        FireWin::allDamaged = false;
 }
 
 bool Core::setRenderer(RenderHook rh) {
@@ -404,6 +773,7 @@ bool Core::setRenderer(RenderHook rh) {
         return false;
     render.replaced = true;
     render.currentRenderer = rh;
+    render.owner = currentOwner;
     return true;
 }
 
@@ -412,60 +782,110 @@ void Core::setDefaultRenderer() {
         return;
 
     render.replaced = false;
+    render.owner = nullptr;
 
     render.currentRenderer =
         std::bind(std::mem_fn(&Core::defaultRenderer), this);
 }
 
-void Core::addSignal(std::string name) {
-    if(signals.find(name) == signals.end())
-        signals[name] = std::vector<SignalListener*>();
+SignalID Core::addSignal(std::string name) {
+    auto it = signalIDs.find(name);
+    if(it != signalIDs.end())
+        return it->second;
+
+    SignalID id = signals.size();
+    signals.emplace_back();
+    signalIDs[name] = id;
+    return id;
 }
 
-void Core::triggerSignal(std::string name, SignalListenerData data) {
-    if(signals.find(name) != signals.end()) {
-        std::vector<SignalListener*> toTrigger;
-        for(auto proc : signals[name])
-            toTrigger.push_back(proc);
+void Core::triggerSignal(SignalID id, SignalData &data) {
+    if(id >= signals.size() || signals[id].listeners.empty())
+        return;
+
+    auto &sig = signals[id];
+    ++sig.dispatching;
 
-        for(auto proc : signals[name])
-            proc->action(data);
+    /* listeners connected during the dispatch
+     * are not run until the next trigger */
+    size_t count = sig.listeners.size();
+    for(size_t i = 0; i < count; i++) {
+        auto proc = sig.listeners[i];
+        if(!proc)
+            continue;
+
+        OwnerScope scope(proc->owner);
+        proc->action(data);
+    }
+
+    if(--sig.dispatching == 0 && sig.dirty) {
+        auto it = std::remove(sig.listeners.begin(),
+                sig.listeners.end(), nullptr);
+        sig.listeners.erase(it, sig.listeners.end());
+        sig.dirty = false;
     }
 }
 
-void Core::connectSignal(std::string name, SignalListener *callback){
-    addSignal(name);
+void Core::connectSignal(SignalID id, SignalListener *callback){
+    if(id >= signals.size())
+        return;
+
+    auto &listeners = signals[id].listeners;
+    if(std::find(listeners.begin(), listeners.end(), callback)
+            != listeners.end())
+        return;
+
     callback->id = nextID++;
-    signals[name].push_back(callback);
+    callback->owner = currentOwner;
+    listeners.push_back(callback);
 }
 
-void Core::disconnectSignal(std::string name, uint id) {
-    auto it = std::remove_if(signals[name].begin(), signals[name].end(),
-            [id](SignalListener *sigl){
-            return sigl->id == id;
-            });
+void Core::connectSignal(std::string name, SignalListener *callback) {
+    connectSignal(addSignal(name), callback);
+}
 
-    signals[name].erase(it, signals[name].end());
+void Core::removeListeners(Signal &sig,
+        std::function<bool(SignalListener*)> pred) {
+    if(sig.dispatching) {
+        for(auto &sigl : sig.listeners)
+            if(sigl && pred(sigl))
+                sigl = nullptr, sig.dirty = true;
+        return;
+    }
+
+    auto it = std::remove_if(sig.listeners.begin(),
+            sig.listeners.end(), pred);
+    sig.listeners.erase(it, sig.listeners.end());
+}
+
+void Core::disconnectSignal(SignalID id, uint lid) {
+    if(id >= signals.size())
+        return;
+
+    removeListeners(signals[id], [lid] (SignalListener *sigl) {
+            return sigl->id == lid;
+        });
+}
+
+void Core::disconnectSignal(std::string name, uint id) {
+    auto it = signalIDs.find(name);
+    if(it != signalIDs.end())
+        disconnectSignal(it->second, id);
 }
 
 void Core::addDefaultSignals() {
     /* map-window and unmap-window are triggered
-     * when a window is (un)mapped. The data they
-     * contain is just a pointer to the FireWindow */
-    addSignal("map-window");
-    addSignal("unmap-window");
+     * when a window is (un)mapped, see MapWindowSignal */
+    mapWindowSignal   = addSignal("map-window");
+    unmapWindowSignal = addSignal("unmap-window");
 
-    /* move-window is triggered when a window is moved
-     * Data contains 3 elements:
-     * 1. raw pointer to FireWin
-     * 2. dx
-     * 3. dy */
-
-    addSignal("move-window");
+    /* move-window is triggered when a window is moved,
+     * see MoveWindowSignal */
+    moveWindowSignal  = addSignal("move-window");
 }
 
-void Core::addWindow(XCreateWindowEvent xev) {
-    FireWindow w = std::make_shared<FireWin>(xev.window, true);
+void Core::addWindow(XCreateWindowEvent xev, WindowCookies &cookies) {
+    FireWindow w = std::make_shared<FireWin>(cookies);
 
     if(xev.parent != root && xev.parent != 0 && !w->transientFor)
         w->transientFor = findWindow(xev.parent);
@@ -479,7 +899,60 @@ void Core::addWindow(Window id) {
     XCreateWindowEvent xev;
     xev.window = id;
     xev.parent = 0;
-    addWindow(xev);
+
+    auto cookies = WinUtil::requestWindowInfo(id);
+    addWindow(xev, cookies);
+}
+
+void Core::flushPendingRequests() {
+    /* creating a window emits signals, plugins might
+     * cause new requests, so take the lists first */
+    auto newWindows = std::move(pendingWindows);
+    pendingWindows.clear();
+
+    for(auto &pw : newWindows)
+        addWindow(pw.xev, pw.cookies);
+
+    auto properties = std::move(pendingProperties);
+    pendingProperties.clear();
+
+    for(auto &pp : properties) {
+        auto reply = WinUtil::getReply(xconn, pp.cookie, xcb_get_property_reply);
+
+        auto w = findWindow(pp.win);
+        if(w) updateProperty(w, pp.atom, reply);
+
+        free(reply);
+    }
+}
+
+void Core::updateProperty(FireWindow w, Atom atom,
+        xcb_get_property_reply_t *reply) {
+    stateDirty = true;
+
+    if(atom == winTypeAtom) {
+        w->type = WinUtil::getWindowType(reply);
+        wins->updateLinks(w);
+        wins->recalcWindowLayer(w);
+        wins->restackTransients(w);
+    }
+
+    if(atom == winStateAtom) {
+        w->state = WinUtil::getWindowState(reply);
+        w->updateState();
+        wins->recalcWindowLayer(w);
+        wins->restackTransients(w);
+    }
+
+    if(atom == XA_WM_TRANSIENT_FOR)
+        w->transientFor = WinUtil::getTransient(reply),
+        wins->updateLinks(w),
+        wins->restackTransients(w);
+
+    if(atom == wmClientLeaderAtom)
+        w->leader = WinUtil::getClientLeader(w->id, reply),
+        wins->updateLinks(w),
+        wins->restackTransients(w);
 }
 
 void Core::focusWindow(FireWindow win) {
@@ -495,9 +968,9 @@ FireWindow Core::getActiveWindow() {
 }
 
 void Core::mapWindow(FireWindow win, bool xmap) {
+    win->syncViewport();
     if(xmap)
-        XMapWindow(d, win->id),
-        XSync(d, 0);
+        XMapWindow(d, win->id);
 
     if(win->initialMapping){
         win->initialMapping = false;
@@ -509,28 +982,32 @@ void Core::mapWindow(FireWindow win, bool xmap) {
     }
 
     win->syncAttrib();
+    finishMapping(win);
+}
+
+void Core::finishMapping(FireWindow win) {
     win->addDamage();
 
+    ignoreErrorsStart();
     if(win->attrib.map_state == IsViewable)
         win->pixmap = XCompositeNameWindowPixmap(d, win->id);
     else
         win->pixmap = 0;
+    ignoreErrorsEnd();
 
     if(win->transientFor)
         wins->restackTransients(win->transientFor);
     wins->checkAddClient(win);
 
-    SignalListenerData v;
-    v.push_back((void*)&win);
-    triggerSignal("map-window", v);
+    MapWindowSignal data(win);
+    triggerSignal(mapWindowSignal, data);
 }
 
 void Core::unmapWindow(FireWindow win) {
     win->attrib.map_state = IsUnmapped;
 
-    SignalListenerData v;
-    v.push_back((void*)&win);
-    triggerSignal("unmap-window", v);
+    MapWindowSignal data(win);
+    triggerSignal(unmapWindowSignal, data);
 
     wins->checkRemoveClient(win);
 }
@@ -578,62 +1055,66 @@ void Core::removeWindow(FireWindow win) {
 }
 
 void Core::wait(int timeout) {
-    poll(&fd, 1, timeout / 1000); // convert from usec to msec
-}
-
-bool Core::checkKey(KeyBinding *kb, XKeyEvent xkey) {
-    if(!kb->active)
-        return false;
-
-    if(kb->key != xkey.keycode)
-        return false;
-
-    if(kb->mod != xkey.state)
-        return false;
-
-    return true;
+    pollfd fds[] = {fd, configFd};
+    poll(fds, 2, timeout / 1000); // convert from usec to msec
+
+    fd.revents = fds[0].revents;
+    if(fds[1].revents & POLLIN && config->checkChanged()) {
+        /* editors write the file in several steps,
+         * so wait a bit before reloading */
+        remTimer(configTimer);
+        configTimer = addTimer(50, [=] () { reloadConfig(); });
+    }
 }
 
-bool Core::checkButPress(ButtonBinding *bb, XButtonEvent xb) {
-
-    if(!bb->active)
-        return false;
+void Core::reloadConfig() {
+    auto start = getTimeMs();
 
-    if(bb->type != BindingTypePress)
-        return false;
+    std::unordered_set<std::string> changed;
+    if(!config->reload(changed)) {
+        std::cout << "[WW] Failed to read the config file, "
+            << "keeping the current options" << std::endl;
+        return;
+    }
 
-    auto state = xb.state & AllModifiers;
-    if(state != bb->mod && bb->mod != AnyModifier)
-        return false;
+    if(changed.find(plug->owner->name) != changed.end())
+        config->setOptionsForPlugin(plug),
+        plug->updateConfiguration(),
+        updateDynamicPlugins();
 
-    if(bb->button != xb.button)
-        return false;
-    return true;
-}
-
-bool Core::checkButRelease(ButtonBinding *bb, XButtonEvent kb) {
-    if(!bb->active)
-        return false;
+    for(auto p : plugins) {
+        if(changed.find(p->owner->name) == changed.end())
+            continue;
 
-    if(bb->type != BindingTypeRelease)
-        return false;
+        OwnerScope scope(p->owner);
+        config->setOptionsForPlugin(p);
+        p->updateConfiguration();
+    }
 
-    if(bb->button != kb.button)
-        return false;
+    std::cout << "[DD] Reloaded config in " << getTimeMs() - start
+        << "ms, " << changed.size() << " sections changed" << std::endl;
 
-    return true;
+    damageRegion(getMaximisedRegion());
 }
 
 void Core::handleEvent(XEvent xev){
+    /* other events might refer to the requested windows
+     * and properties, so they must be up to date */
+    if(xev.type != CreateNotify && xev.type != PropertyNotify)
+        flushPendingRequests();
+
     switch(xev.type) {
         case Expose:
             dmg = getMaximisedRegion();
             break;
         case KeyPress: {
-            // check keybindings
-            for(auto kb : keys)
-                if(checkKey(kb, xev.xkey))
-                   kb->action(new Context(xev));
+            Context ctx(xev);
+            dispatchBindings(keyTable,
+                    bindingKey(xev.xkey.keycode, xev.xkey.state),
+                    [&ctx] (KeyBinding *kb) {
+                        kb->action(&ctx);
+                        return false;
+                    });
             break;
         }
 
@@ -653,13 +1134,16 @@ void Core::handleEvent(XEvent xev){
                 wins->removeWindow(it);
             }
 
-            addWindow(xev.xcreatewindow);
+            pendingWindows.push_back({xev.xcreatewindow,
+                    WinUtil::requestWindowInfo(xev.xcreatewindow.window)});
             break;
         }
         case DestroyNotify: {
             auto w = wins->findWindow(xev.xdestroywindow.window);
             if(!w) break;
             w->destroyed = true;
+            w->markDirty();
+            stateDirty = true;
             if(!w->keepCount)
                 removeWindow(w);
             break;
@@ -672,12 +1156,14 @@ void Core::handleEvent(XEvent xev){
         case MapNotify: {
             auto w = findWindow(xev.xmap.window);
             if(w) mapWindow(w, false),
-                  wins->focusWindow(w);
+                  wins->focusWindow(w),
+                  stateDirty = true;
             break;
         }
         case UnmapNotify: {
             auto w = wins->findWindow(xev.xunmap.window);
-            if(w) unmapWindow(w);
+            if(w) unmapWindow(w),
+                  stateDirty = true;
             break;
         }
 
@@ -685,23 +1171,37 @@ void Core::handleEvent(XEvent xev){
             mousex = xev.xbutton.x_root;
             mousey = xev.xbutton.y_root;
 
-            for(auto bb : buttons) {
-                if(checkButPress(bb, xev.xbutton)) {
-                    bb->action(new Context(xev));
-                    break;
-                }
-            }
+            /* only the first matching binding is run,
+             * bindings with exactly these modifiers go first */
+            Context ctx(xev);
+            bool done = false;
+            auto run = [&ctx, &done] (ButtonBinding *bb) {
+                bb->action(&ctx);
+                return done = true;
+            };
+
+            auto state = xev.xbutton.state & AllModifiers;
+            dispatchBindings(pressTable,
+                    bindingKey(xev.xbutton.button, state), run);
+            if(!done)
+                dispatchBindings(pressTable,
+                        bindingKey(xev.xbutton.button, AnyModifier), run);
 
             XAllowEvents(d, ReplayPointer, xev.xbutton.time);
             break;
         }
-        case ButtonRelease:
-            for(auto bb : this->buttons)
-                if(checkButRelease(bb, xev.xbutton))
-                    bb->action(new Context(xev));
+        case ButtonRelease: {
+            Context ctx(xev);
+            dispatchBindings(releaseTable,
+                    bindingKey(xev.xbutton.button, AnyModifier),
+                    [&ctx] (ButtonBinding *bb) {
+                        bb->action(&ctx);
+                        return false;
+                    });
 
             XAllowEvents(d, ReplayPointer, xev.xbutton.time);
             break;
+        }
 
         case MotionNotify:
             mousex = xev.xmotion.x_root;
@@ -728,6 +1228,9 @@ void Core::handleEvent(XEvent xev){
                 break;
             }
 
+            /* the request is relative to the current viewport */
+            w->syncViewport();
+
             int width = w->attrib.width, height = w->attrib.height;
             int x = w->attrib.x, y = w->attrib.y;
 
@@ -772,33 +1275,16 @@ void Core::handleEvent(XEvent xev){
 //                }
 //            }
             mapWindow(w, false);
-
+            break;
         }
 
         case PropertyNotify: {
-            auto w = findWindow(xev.xproperty.window);
-            if(!w) break;
+            auto atom = xev.xproperty.atom;
+            if(atom == winTypeAtom || atom == winStateAtom ||
+               atom == XA_WM_TRANSIENT_FOR || atom == wmClientLeaderAtom)
 
-            if(xev.xproperty.atom == winTypeAtom) {
-                w->type = WinUtil::getWindowType(w->id);
-                wins->recalcWindowLayer(w);
-                wins->restackTransients(w);
-            }
-
-            if(xev.xproperty.atom == winStateAtom) {
-                w->state = WinUtil::getWindowState(w->id);
-                w->updateState();
-                wins->recalcWindowLayer(w);
-                wins->restackTransients(w);
-            }
-
-            if(xev.xproperty.atom == XA_WM_TRANSIENT_FOR)
-                w->transientFor = WinUtil::getTransient(w->id),
-                wins->restackTransients(w);
-
-            if(xev.xproperty.atom == wmClientLeaderAtom)
-                w->leader = WinUtil::getClientLeader(w->id),
-                wins->restackTransients(w);
+                pendingProperties.push_back({xev.xproperty.window, atom,
+                        WinUtil::requestProperty(xev.xproperty.window, atom)});
             break;
         }
 
@@ -824,11 +1310,13 @@ void Core::handleEvent(XEvent xev){
         }
 
         case ClientMessage: {
-            if (xev.xclient.message_type == activeWinAtom) {
-                auto w = findWindow(xev.xclient.window);
-                if(!w) break;
+            auto w = findWindow(xev.xclient.window);
+            if(!w) break;
+
+            /* the client might read its geometry after the request */
+            w->syncViewport();
+            if (xev.xclient.message_type == activeWinAtom)
                 wins->focusWindow(w);
-            }
             break;
         }
 
@@ -846,9 +1334,6 @@ void Core::handleEvent(XEvent xev){
 
         default:
             if(xev.type == damage + XDamageNotify) {
-                if(FireWin::allDamaged)
-                    break;
-
                 XDamageNotifyEvent *x =
                     reinterpret_cast<XDamageNotifyEvent*> (&xev);
 
@@ -857,16 +1342,22 @@ void Core::handleEvent(XEvent xev){
 
                 w->damaged = true;
 
-                if(!w->visible)
-                    break;
-
-                auto damagedArea = getREGIONFromRect(
-                        x->area.x + w->attrib.x,
-                        x->area.y + w->attrib.y,
-                        x->area.x + w->attrib.x + x->area.width,
-                        x->area.y + w->attrib.y + x->area.height);
-
-                damageREGION(damagedArea);
+                GetTuple(dx, dy, w->getViewportOffset());
+                auto area = getRegionFromRect(
+                        x->area.x + w->attrib.x + dx,
+                        x->area.y + w->attrib.y + dy,
+                        x->area.x + w->attrib.x + dx + x->area.width,
+                        x->area.y + w->attrib.y + dy + x->area.height);
+
+                /* off-screen windows only damage cached viewports,
+                 * which are redrawn if some plugin shows them */
+                if(w->visible)
+                    damageRegion(area);
+                else {
+                    viewportCache->damage(area);
+                    if(viewportCache->inUse())
+                        scheduleRedraw();
+                }
             break;
             }
     }
@@ -882,7 +1373,7 @@ void Core::loop(){
         return;
     }
 
-    int currentCycle = Second / plug->options["rrate"]->data.ival;
+    int currentCycle = Second / *plug->rrate;
     int baseCycle = currentCycle;
 
     timeval before, after;
@@ -896,13 +1387,31 @@ void Core::loop(){
             XNextEvent(d, &xev);
             handleEvent(xev);
         }
+        flushPendingRequests();
+
+        /* timers which damage something must be drawn
+         * on time, so disable idle optimisation */
+        if(timers.advance(getTimeMs()))
+            hadEvents = true,
+            currentCycle = baseCycle;
+
+        if(stateDirty)
+            saveState();
+
+        /* send all requests from this cycle at once */
+        XFlush(d);
 
         gettimeofday(&after, 0);
         int diff = (after.tv_sec - before.tv_sec) * 1000000 +
             after.tv_usec - before.tv_usec;
 
         if(diff < currentCycle) {     // we have time to next redraw, wait
-            wait(currentCycle - diff);// for events
+            int timeout = currentCycle - diff; // for events or next timer
+            int nextTimer = timers.nextTimeout();
+            if(nextTimer >= 0 && nextTimer * 1000 < timeout)
+                timeout = nextTimer * 1000;
+
+            wait(timeout);
             if(fd.revents & POLLIN || !resetDMG || cntHooks) {
                 /* disable optimisation */
                 hadEvents = true;
@@ -924,13 +1433,25 @@ void Core::loop(){
                     if(hook->getState())
                         runningHooks.push_back(hook);
 
-                for(auto hook : runningHooks)
+                for(auto hook : runningHooks) {
+                    OwnerScope scope(hook->owner);
                     hook->action();
+                }
             }
 
             /* if some screen region is damaged, draw it */
-            if(FireWin::allDamaged || !XEmptyRegion(dmg))
+            if(FireWin::allDamaged || !dmg.empty() || redrawScheduled) {
+                redrawScheduled = false;
                 render.currentRenderer();
+                if(!firstFrameDone)
+                    onFirstFrame();
+
+                if(resetDMG)
+                    dmg.clear(),
+                    FireWin::allDamaged = false;
+
+                regionArena.reset();
+            }
 
             /* optimisation when idle */
             if(!cntHooks && !hadEvents && resetDMG)
@@ -948,7 +1469,40 @@ int Core::onOtherWmDetected(Display* d, XErrorEvent *xev) {
     return 0;
 }
 
+void Core::ignoreErrorsStart() {
+    /* a nested range is covered by the outer one */
+    if(ignoreDepth++ > 0)
+        return;
+
+    /* errors for requests up to the last processed one have
+     * been handled already, so the ranges before it are done */
+    auto last = LastKnownRequestProcessed(d);
+    while(!ignoredErrors.empty() && ignoredErrors.front().second < last)
+        ignoredErrors.pop_front();
+
+    ignoredErrors.push_back(std::make_pair(NextRequest(d), ULONG_MAX));
+}
+
+void Core::ignoreErrorsEnd() {
+    if(ignoreDepth == 0 || --ignoreDepth > 0)
+        return;
+
+    /* if no request was issued, the range is empty */
+    ignoredErrors.back().second = NextRequest(d) - 1;
+}
+
 int Core::onXError(Display *d, XErrorEvent *xev) {
+    auto &ignored = core->ignoredErrors;
+
+    /* errors arrive in order, so ranges before
+     * this error won't be needed anymore */
+    while(!ignored.empty() && ignored.front().second < xev->serial)
+        ignored.pop_front();
+
+    for(auto range : ignored)
+        if(range.first <= xev->serial && xev->serial <= range.second)
+            return 0;
+
     if(xev->resourceid == 0) // invalid window
         return 0;
 
@@ -958,6 +1512,8 @@ int Core::onXError(Display *d, XErrorEvent *xev) {
     XGetErrorText(d, xev->error_code, buf, 512);
     std::cout << "XError string " << buf << std::endl;
     std::cout << "ResourceID = " << xev->resourceid << std::endl;
+    std::cout << "Request code = " << int(xev->request_code) <<
+        " serial = " << xev->serial << std::endl;
     std::cout << "____________________________" << std::endl << std::endl;
 
     //print_trace();
@@ -987,27 +1543,36 @@ void Core::switchWorkspace(std::tuple<int, int> nPos) {
     if(nx >= vwidth || ny >= vheight || nx < 0 || ny < 0)
         return;
 
-    auto dx = (vx - nx) * width;
-    auto dy = (vy - ny) * height;
-    GetTuple(sw, sh, core->getScreenSize());
+    /* only windows on the old and on the new viewport become
+     * invisible or visible, so only they are moved now. The others
+     * stay off-screen, they are rendered with the viewport offset in
+     * their transform and are moved when needed, see syncViewport() */
+    auto changed = wins->getWindowsInRect(FireBox{0, 0, width, height});
+    for(auto &w : wins->getWindowsInRect(FireBox{(nx - vx) * width,
+                (ny - vy) * height, (nx - vx + 1) * width,
+                (ny - vy + 1) * height}))
+        changed.push_back(w);
 
-    using namespace std::placeholders;
-    auto proc = [dx, dy, sw, sh] (FireWindow w) {
+    vx = nx;
+    vy = ny;
+    wins->updateGrid();
+    Transform::gviewport = glm::translate(glm::mat4(),
+            glm::vec3(-2 * vx, 2 * vy, 0));
+    stateDirty = true;
+
+    for(auto &w : changed) {
         //if(w->state & WindowStateSticky)
-        //    return;
-        w->move(w->attrib.x + dx, w->attrib.y + dy);
+        //    continue;
+        w->syncViewport();
 
-        if(w->attrib.x > sw || w->attrib.y > sh ||
+        if(w->attrib.x > width || w->attrib.y > height ||
                 w->attrib.x + w->attrib.width < 0 ||
                 w->attrib.y + w->attrib.height < 0)
             w->visible = false;
         else
             w->visible = true;
-    };
-    wins->forEachWindow(proc);
-
-    vx = nx;
-    vy = ny;
+        w->markDirty();
+    }
 
     auto ws = getWindowsOnViewport(this->getWorkspace());
     if(ws.size() != 0)
@@ -1022,27 +1587,17 @@ std::vector<FireWindow> Core::getWindowsOnViewport(std::tuple<int, int> vp) {
                        (x - vx + 1) * width, (y - vy + 1) * height);
 
     std::vector<FireWindow> ret;
-    Region tmp = XCreateRegion();
-
-    auto proc = [view, &ret, tmp] (FireWindow w) {
-        if(!w->region)
-            return;
-
-        if(w->state & WindowStateSkipTaskbar)
-            return;
 
-        if(w->type == WindowTypeWidget ||
-                w->type == WindowTypeDock)
-            return;
-
-        XIntersectRegion(view, w->region, tmp);
-        if(tmp && !XEmptyRegion(tmp) && !w->norender)
-            ret.push_back(w);
+    auto candidate = [] (const FireWindow &w) {
+        return !w->region.empty() && !w->norender &&
+            !(w->state & WindowStateSkipTaskbar) &&
+            w->type != WindowTypeWidget &&
+            w->type != WindowTypeDock;
     };
 
-    wins->forEachWindow(proc);
-    XDestroyRegion(view);
-    XDestroyRegion(tmp);
+    for(auto &w : wins->getWindowsInRect(view.extents()))
+        if(candidate(w) && view.overlaps(w->getScreenRegion()))
+            ret.push_back(w);
 
     return ret;
 }
@@ -1050,41 +1605,58 @@ std::vector<FireWindow> Core::getWindowsOnViewport(std::tuple<int, int> vp) {
 void Core::getViewportTexture(std::tuple<int, int> vp,
         GLuint &fbuff, GLuint &texture) {
 
-    OpenGL::useDefaultProgram();
     if(fbuff == -1 || texture == -1)
         OpenGL::prepareFramebuffer(fbuff, texture);
+
+    FireWin::allDamaged = true;
+    renderViewport(vp, fbuff, getMaximisedRegion());
+}
+
+void Core::renderViewport(std::tuple<int, int> vp, GLuint fbuff,
+        const FireRegion &damage) {
+
+    OpenGL::useDefaultProgram();
     OpenGL::preStage(fbuff);
+
+    auto &box = damage.extents();
+    glScissor(box.x1, height - box.y2, box.x2 - box.x1, box.y2 - box.y1);
     glClear(GL_COLOR_BUFFER_BIT);
 
     GetTuple(x, y, vp);
+
+    /* off-screen windows are drawn only if everything is */
+    bool saveDamaged = FireWin::allDamaged;
     FireWin::allDamaged = true;
 
-    auto view = getRegionFromRect((x - vx) * width, (y - vy) * height,
-                       (x - vx + 1) * width, (y - vy + 1) * height);
+    /* all of the box was cleared, so the windows
+     * anywhere in it have to be drawn, not only those
+     * in damage */
+    FireRegion view(box);
+    view.translate((x - vx) * width, (y - vy) * height);
 
     glm::mat4 off = glm::translate(glm::mat4(),
             glm::vec3(2 * (vx - x), 2 * (y - vy), 0));
     glm::mat4 save = Transform::gtrs;
     Transform::gtrs *= off;
 
-    Region tmp = XCreateRegion();
-    std::vector<FireWindow> winsToDraw;
+    std::vector<FireWin*> winsToDraw;
 
-    auto proc = [view, tmp, &winsToDraw](FireWindow win) {
-        if(!win->isVisible() || !win->region)
-            return;
-
-        XIntersectRegion(view, win->region, tmp);
-        if(!XEmptyRegion(tmp))
-            winsToDraw.push_back(win);
+    auto visible = [] (const FireWindow &win) {
+        return win->isVisible() && !win->region.empty();
     };
-    wins->forEachWindow(proc);
+
+    for(auto &win : wins->getWindowsInRect(view.extents()))
+        if(visible(win) && view.overlaps(win->getScreenRegion()))
+            winsToDraw.push_back(win.get());
 
     auto it = winsToDraw.rbegin();
     while(it != winsToDraw.rend())
         (*it++)->render();
 
     Transform::gtrs = save;
+    FireWin::allDamaged = saveDamaged;
+
+    glScissor(0, 0, width, height);
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
 }
 
@@ -1107,45 +1679,78 @@ void Core::setRedrawEverything(bool val) {
         core->resetDMG = true;
 }
 
-REGION Core::getREGIONFromRect(int tlx, int tly, int brx, int bry) {
-    REGION r;
-    r.numRects = r.size = 1;
-    r.rects = new BOX[1];
-    r.extents.x1 = r.rects[0].x1 = tlx;
-    r.extents.y1 = r.rects[0].y1 = tly;
-    r.extents.x2 = r.rects[0].x2 = brx;
-    r.extents.y2 = r.rects[0].y2 = bry;
-    return r;
-}
-
-Region Core::getRegionFromRect(int tlx, int tly, int brx, int bry) {
-    auto r = getREGIONFromRect(tlx, tly, brx, bry);
-    Region ret;
-    ret = XCreateRegion();
-    XUnionRegion(&r, ret, ret);
-    return ret;
+FireRegion Core::getRegionFromRect(int tlx, int tly, int brx, int bry) {
+    return FireRegion(tlx, tly, brx, bry);
 }
 
-Region Core::getMaximisedRegion() {
+FireRegion Core::getMaximisedRegion() {
     return getRegionFromRect(0, 0, width, height);
 }
 
-#define MAX_DAMAGED_RECTS 150
+/* when the damage has more boxes than MaxDamageBoxes,
+ * nearby boxes are merged as long as this adds at most
+ * MaxDamageWaste times the damaged area, otherwise
+ * everything is repainted */
+#define MaxDamageBoxes 32
+#define MaxDamageWaste 0.5f
 
-void Core::damageRegion(Region r) {
-    XUnionRegion(r, dmg, dmg);
-    if(dmg->numRects > MAX_DAMAGED_RECTS)
-        FireWin::allDamaged = true;
+void Core::damageRegion(const FireRegion &r) {
+    viewportCache->damage(r);
+    if(FireWin::allDamaged)
+        return;
+
+    dmg.unite(r);
+    if(dmg.size() <= MaxDamageBoxes)
+        return;
+
+    int merges = dmg.simplify(MaxDamageBoxes, MaxDamageWaste);
+    if(merges < 0)
+        FireWin::allDamaged = true,
+        damageStats.fullDamage++;
+    else
+        damageStats.simplified++,
+        damageStats.merges += merges;
 }
 
-void Core::damageREGION(REGION r) {
-    damageRegion(&r);
+void Core::scheduleRedraw() {
+    redrawScheduled = true;
 }
 
 int Core::getRefreshRate() {
     return refreshrate;
 }
 
+int Core::getGPUIdleTime() {
+    return *plug->gpuidle;
+}
+
+DataSlot Core::allocDataSlot() {
+    for(int i = 0; i < MaxDataSlots; i++) {
+        if(slotUsed[i])
+            continue;
+
+        slotUsed[i] = true;
+        slotOwners[i] = currentOwner;
+        return i;
+    }
+
+    std::cout << "[EE] No free window data slots" << std::endl;
+    return -1;
+}
+
+void Core::freeDataSlot(DataSlot slot) {
+    if(slot < 0 || slot >= MaxDataSlots || !slotUsed[slot])
+        return;
+
+    wins->forEachWindow([slot] (const FireWindow &w) {
+        delete w->data[slot];
+        w->data[slot] = nullptr;
+    });
+
+    slotUsed[slot] = false;
+    slotOwners[slot] = nullptr;
+}
+
 #define uchar unsigned char
 namespace {
     GLuint getFilledTexture(int w, int h, uchar r, uchar g, uchar b, uchar a) {
@@ -1170,10 +1775,14 @@ namespace {
 void Core::setBackground(const char *path) {
     std::cout << "[DD] Background file: " << path << std::endl;
 
-    auto texture = GLXUtils::loadImage(const_cast<char*>(path));
+    /* decoding the image is slow, so use a plain
+     * texture until the first frame is shown */
+    auto texture = getFilledTexture(width, height, 128, 128, 128, 255);
 
-    if(texture == -1)
-        texture = getFilledTexture(width, height, 128, 128, 128, 255);
+    std::string file = path;
+    runAfterFirstFrame([=] () {
+        loadBackgroundImage(file);
+    });
 
     uint vao, vbo;
     OpenGL::generateVAOVBO(0, height, width, -height, vao, vbo);
@@ -1208,6 +1817,20 @@ void Core::setBackground(const char *path) {
     }
 }
 
+void Core::loadBackgroundImage(std::string path) {
+    auto texture = GLXUtils::loadImage(const_cast<char*>(path.c_str()));
+    if(texture == (GLuint)-1 || backgrounds.empty())
+        return;
+
+    auto old = backgrounds[0][0]->texture;
+    for(auto &row : backgrounds)
+        for(auto &bg : row)
+            bg->texture = texture;
+
+    glDeleteTextures(1, &old);
+    damageRegion(getMaximisedRegion());
+}
+
 namespace {
     template<class A, class B> B unionCast(A object) {
         union {
@@ -1239,30 +1862,116 @@ PluginPtr Core::loadPluginFromFile(std::string path, void **h) {
     return std::shared_ptr<Plugin>(init());
 }
 
+PluginPtr Core::loadDynamicPlugin(std::string name) {
+    auto path = *plug->pluginpath + "/fireman/";
+
+    void *handle;
+    auto ptr = loadPluginFromFile(path + "/lib" + name + ".so", &handle);
+    if(ptr) ptr->handle   = handle,
+            ptr->dynamic  = true,
+            ptr->fileName = name;
+
+    return ptr;
+}
+
 void Core::loadDynamicPlugins() {
-    std::stringstream stream(*plug->options["plugins"]->data.sval);
-    auto path = *plug->options["pluginpath"]->data.sval+"/fireman/";
+    std::stringstream stream(*plug->plugins);
 
     std::string plugin;
     while(stream >> plugin){
         if(plugin != "") {
-            void *handle;
-            auto ptr = loadPluginFromFile(path + "/lib" + plugin + ".so",
-                    &handle);
-            if(ptr) ptr->handle  = handle,
-                    ptr->dynamic = true,
-                    plugins.push_back(ptr);
+            auto ptr = loadDynamicPlugin(plugin);
+            if(ptr) plugins.push_back(ptr);
         }
     }
 }
 
+void Core::initPlugin(PluginPtr p) {
+    p->owner = std::make_shared<_Ownership>();
+    p->initOwnership();
+    regOwner(p->owner);
+
+    OwnerScope scope(p->owner);
+    p->init();
+    config->setOptionsForPlugin(p);
+    p->updateConfiguration();
+}
+
+bool Core::loadPlugin(std::string name) {
+    for(auto p : plugins)
+        if(p->dynamic && p->fileName == name)
+            return true;
+
+    auto ptr = loadDynamicPlugin(name);
+    if(!ptr)
+        return false;
+
+    initPlugin(ptr);
+    plugins.push_back(ptr);
+
+    std::cout << "[DD] Loaded plugin " << name << std::endl;
+    return true;
+}
+
+void Core::unloadPlugin(std::string name) {
+    auto it = std::find_if(plugins.begin(), plugins.end(),
+            [name] (PluginPtr p) {
+                return p->dynamic && p->fileName == name;
+            });
+
+    if(it == plugins.end())
+        return;
+
+    auto p = *it;
+    plugins.erase(it);
+
+    if(p->owner->active)
+        deactivateOwner(p->owner);
+
+    {
+        OwnerScope scope(p->owner);
+        p->fini();
+    }
+
+    removeOwnedBy(p->owner);
+    owners.erase(p->owner);
+
+    /* the plugin's code is in the library,
+     * so it must be destroyed before closing it */
+    auto handle = p->handle;
+    p.reset();
+    dlclose(handle);
+
+    std::cout << "[DD] Unloaded plugin " << name << std::endl;
+}
+
+void Core::updateDynamicPlugins() {
+    std::stringstream stream(*plug->plugins);
+    std::unordered_set<std::string> wanted;
+
+    std::string plugin;
+    while(stream >> plugin)
+        wanted.insert(plugin);
+
+    std::vector<std::string> toUnload;
+    for(auto p : plugins)
+        if(p->dynamic && wanted.find(p->fileName) == wanted.end())
+            toUnload.push_back(p->fileName);
+
+    for(auto name : toUnload)
+        unloadPlugin(name);
+
+    for(auto name : wanted)
+        loadPlugin(name);
+}
+
 template<class T>
 PluginPtr Core::createPlugin() {
     return std::static_pointer_cast<Plugin>(std::make_shared<T>());
 }
 
 void Core::initDefaultPlugins() {
-    plug = createPlugin<CorePlugin>();
+    plug = std::make_shared<CorePlugin>();
     plugins.push_back(createPlugin<Focus>());
     plugins.push_back(createPlugin<Exit>());
     plugins.push_back(createPlugin<Close>());
@@ -9,15 +9,19 @@
 #include <execinfo.h>
 #include <cxxabi.h>
 
-/* shdata keeps all the shared memory between first process and fork()
- * shdata[0] is a flag whether to restart or no
- * shdata[1] and shdata[2] are initial viewport x and y */
+/* shared keeps all the shared memory between first process and fork(),
+ * see state.hpp */
 
-char *shdata;
+SharedState *shared;
 constexpr int shmkey = 1010101234;
-constexpr int shmsize = 8;
+constexpr int shmsize = sizeof(SharedState);
 int shmid;
 
+bool isStateValid() {
+    return shared->magic == StateMagic &&
+        shared->version == StateVersion;
+}
+
 Config *config;
 
 #define Crash 101
@@ -108,13 +112,14 @@ void signalHandle(int sig) {
     switch(sig) {
         case SIGINT:                 // if interrupted, then
             std::cout << "EXITING BECAUSE OF SIGINT" << std::endl;
-            shdata[0] = 0;         // make main loop exit
+            shared->restart = 0;     // make main loop exit
             core->terminate = true;  // and make core exit
             break;
 
         case SIGUSR1:
             std::cout << "SIGUSR1" << std::endl;
-            shdata[0] = 1;
+            shared->restart = 1;
+            shared->restartTime = getTimeMs();
             if(!core)
                 std::cout << "in main process" << std::endl;
             else {
@@ -126,14 +131,11 @@ void signalHandle(int sig) {
 
         default: // program crashed, so restart core
             std::cout << "Crash Detected!!!!!!" << std::endl;
-            shdata[0] = 1;
-
-            // try to fully recover, i.e do not lose windows
+            shared->restart = 1;
 
-            GetTuple(vx, vy, core->getWorkspace());
-
-            shdata[1] = int(vx);
-            shdata[2] = int(vy);
+            /* the state itself is already saved by core,
+             * writing it here is not safe */
+            shared->restartTime = getTimeMs();
 
             print_trace();
             delete core;
@@ -157,8 +159,8 @@ void runOnce(std::string configPath, int glVersionMajor,
 
     shmid = shmget(shmkey, shmsize, 0666);
     auto dataid = shmat(shmid, 0, 0);
-    shdata = (char*)dataid;
-    shdata[0] = 0;
+    shared = (SharedState*)dataid;
+    shared->restart = 0;
 
     signal(SIGINT, signalHandle);
     signal(SIGSEGV, signalHandle);
@@ -171,18 +173,16 @@ void runOnce(std::string configPath, int glVersionMajor,
     Transform::grot = Transform::gscl =
     Transform::gtrs = glm::mat4();
 
-    core = new Core(shdata[1], shdata[2]);
+    core = new Core(shared->vx, shared->vy);
     core->init();
     core->loop();
 
+    core->saveState();
     if(core->mainrestart)
-        shdata[0] = 1;
+        shared->restart = 1,
+        shared->restartTime = getTimeMs();
 
-    GetTuple(vx, vy, core->getWorkspace());
     delete core;
-
-    shdata[1] = int(vx);
-    shdata[2] = int(vy);
 }
 
 int main(int argc, char * const* argv ) {
@@ -247,17 +247,17 @@ int main(int argc, char * const* argv ) {
 
     shmid = shmget(shmkey, shmsize, 0666 | IPC_CREAT);
     auto dataid = shmat(shmid, 0, 0);
-    shdata = (char*)dataid;
+    shared = (SharedState*)dataid;
 
     if(dataid == (void*)(-1)) {
         std::cout << "Failed to get shared memory, aborting..." << std::endl;
         std::exit(-1);
     }
-    shdata[0] = 1;
-    shdata[1] = shdata[2] = 0;
+    std::memset(shared, 0, sizeof(SharedState));
+    shared->restart = 1;
 
     int times = 0;
-    while(shdata[0]) {
+    while(shared->restart) {
         std::cout << "In cycle" << std::endl;
         if(times++) // print a message if there has been crash
                     // but note that it could have just been a refresh
@@ -6,6 +6,7 @@ namespace {
     GLuint depthID, colorID, bgraID;
     glm::mat4 View;
     glm::mat4 Proj;
+    glm::mat4 ProjView;
     glm::mat4 MVP;
 
     GLuint framebuffer;
@@ -140,19 +141,29 @@ void renderTexture(GLuint tex, GLuint vao, GLuint vbo) {
     glDrawArrays (GL_TRIANGLES, 0, 6);
 }
 
+void renderTextureMVP(GLuint tex,
+        GLuint vao, GLuint vbo,
+        const glm::mat4 &mvp) {
+    glUniformMatrix4fv(mvpID, 1, GL_FALSE, &mvp[0][0]);
+    glUniform1i(depthID, depth);
+    glUniform4fv(colorID, 1, &color[0]);
+
+    renderTexture(tex, vao, vbo);
+}
+
 void renderTransformedTexture(GLuint tex,
         GLuint vao, GLuint vbo,
         glm::mat4 Model) {
     if(transformed)
-        MVP = Proj * View * Model;
+        MVP = multiplyMatrices(ProjView, Model);
     else
         MVP = Model;
 
-    glUniformMatrix4fv(mvpID, 1, GL_FALSE, &MVP[0][0]);
-    glUniform1i(depthID, depth);
-    glUniform4fv(colorID, 1, &color[0]);
+    renderTextureMVP(tex, vao, vbo, MVP);
+}
 
-    renderTexture(tex, vao, vbo);
+const glm::mat4& getProjView() {
+    return ProjView;
 }
 
 void preStage() {
@@ -164,12 +175,11 @@ void preStage() {
         return;
     }
 
-    XRectangle rect;
-    XClipBox(core->dmg, &rect);
+    auto &box = core->dmg.extents();
 
-    int blx = rect.x;
-    int bly = sh - (rect.y + rect.height);
-    glScissor(blx, bly, rect.width, rect.height);
+    int blx = box.x1;
+    int bly = sh - box.y2;
+    glScissor(blx, bly, box.x2 - box.x1, box.y2 - box.y1);
 }
 
 void preStage(GLuint fbuff) {
@@ -279,6 +289,7 @@ void initOpenGL(const char *shaderSrcPath) {
                        glm::vec3(0., 0., 0.),
                        glm::vec3(0., 1., 0.));
     Proj = glm::perspective(45.f, 1.f, .1f, 100.f);
+    ProjView = Proj * View;
 
     MVP = glm::mat4();
 
@@ -5,8 +5,6 @@ namespace {
 }
 
 Data::Data(){}
-SubData::SubData() {}
-SubData::~SubData() {}
 
 void _Ownership::grab() {
     if(this->grabbed || !this->active)
@@ -50,6 +48,11 @@ void Plugin::initOwnership() {
 void Plugin::updateConfiguration() {}
 void Plugin::fini() {}
 
+Plugin::~Plugin() {
+    for(auto option : options)
+        delete option.second;
+}
+
 DataPair newIntOption(std::string name, int defaultVal) {
     auto pair = std::make_pair(name, new Data());
     pair.second->type = DataTypeInt;
@@ -74,25 +77,25 @@ DataPair newBoolOption(std::string name, bool defaultVal) {
 DataPair newStringOption(std::string name, std::string defaultVal) {
     auto pair = std::make_pair(name, new Data());
     pair.second->type = DataTypeString;
-    pair.second->def.sval = new std::string(defaultVal);
+    pair.second->def.sval = defaultVal;
     return pair;
 }
 
 DataPair newColorOption(std::string name, Color defaultVal) {
     auto pair = std::make_pair(name, new Data());
     pair.second->type = DataTypeColor;
-    pair.second->def.color = new Color(defaultVal);
+    pair.second->def.color = defaultVal;
     return pair;
 }
 DataPair newKeyOption(std::string name, Key defaultVal) {
     auto pair = std::make_pair(name, new Data());
     pair.second->type = DataTypeKey;
-    pair.second->def.key = new Key(defaultVal);
+    pair.second->def.key = defaultVal;
     return pair;
 }
 DataPair newButtonOption(std::string name, Button defaultVal) {
     auto pair = std::make_pair(name, new Data());
     pair.second->type = DataTypeButton;
-    pair.second->def.but = new Button(defaultVal);
+    pair.second->def.but = defaultVal;
     return pair;
 }
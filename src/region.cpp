@@ -0,0 +1,489 @@
+#include <region.hpp>
+
+RegionArena regionArena;
+
+void RegionArena::reset() {
+    highWater = std::max(highWater, boxes.capacity());
+    boxes.clear();
+}
+
+namespace {
+    inline bool boxesOverlap(const FireBox &a, const FireBox &b) {
+        return a.x1 < b.x2 && b.x1 < a.x2 &&
+               a.y1 < b.y2 && b.y1 < a.y2;
+    }
+
+    inline bool boxContains(const FireBox &a, const FireBox &b) {
+        return a.x1 <= b.x1 && a.y1 <= b.y1 &&
+               a.x2 >= b.x2 && a.y2 >= b.y2;
+    }
+
+    /* unites the x intervals of two bands,
+     * emit(x1, x2) is called for each resulting interval */
+    template<class Emit>
+    void uniteBands(const FireBox *a, int na, const FireBox *b, int nb, Emit emit) {
+        int i = 0, j = 0;
+        int x1 = 0, x2 = 0;
+        bool open = false;
+
+        while(i < na || j < nb) {
+            auto &next = (j >= nb || (i < na && a[i].x1 <= b[j].x1)) ?
+                a[i++] : b[j++];
+
+            if(open && next.x1 <= x2) {
+                x2 = std::max(x2, next.x2);
+                continue;
+            }
+
+            if(open)
+                emit(x1, x2);
+            x1 = next.x1, x2 = next.x2, open = true;
+        }
+
+        if(open)
+            emit(x1, x2);
+    }
+
+    /* index of the first box after the band starting at i */
+    inline int bandEnd(const FireBox *boxes, int count, int i) {
+        int y1 = boxes[i].y1;
+        while(i < count && boxes[i].y1 == y1)
+            ++i;
+        return i;
+    }
+
+    /* merges vertically adjacent bands with the same boxes,
+     * in place. Returns the new number of boxes */
+    int coalesceBands(FireBox *boxes, int count) {
+        int n = 0, prev = -1;
+        for(int i = 0, e; i < count; i = e) {
+            e = bandEnd(boxes, count, i);
+
+            int size = e - i;
+            bool merge = prev >= 0 && n - prev == size &&
+                boxes[prev].y2 == boxes[i].y1;
+            for(int k = 0; merge && k < size; k++)
+                merge = boxes[prev + k].x1 == boxes[i + k].x1 &&
+                        boxes[prev + k].x2 == boxes[i + k].x2;
+
+            if(merge) {
+                for(int k = 0; k < size; k++)
+                    boxes[prev + k].y2 = boxes[i].y2;
+                continue;
+            }
+
+            prev = n;
+            for(int k = i; k < e; k++)
+                boxes[n++] = boxes[k];
+        }
+
+        return n;
+    }
+}
+
+FireRegion::FireRegion(int x1, int y1, int x2, int y2) {
+    if(x1 < x2 && y1 < y2)
+        boxes[0] = ext = FireBox{x1, y1, x2, y2}, count = 1;
+}
+
+FireRegion::FireRegion(const FireBox &box)
+    : FireRegion(box.x1, box.y1, box.x2, box.y2) {}
+
+FireRegion::FireRegion(const FireRegion &other) {
+    assign(other.boxes, other.count);
+}
+
+FireRegion::FireRegion(FireRegion &&other) {
+    *this = std::move(other);
+}
+
+FireRegion::~FireRegion() {
+    if(boxes != inlineBoxes)
+        delete[] boxes;
+}
+
+FireRegion& FireRegion::operator = (const FireRegion &other) {
+    if(this != &other)
+        assign(other.boxes, other.count);
+    return *this;
+}
+
+FireRegion& FireRegion::operator = (FireRegion &&other) {
+    if(this == &other)
+        return *this;
+
+    /* take other's buffer only if it is bigger than ours */
+    if(other.boxes != other.inlineBoxes && other.capacity > capacity) {
+        if(boxes != inlineBoxes)
+            delete[] boxes;
+
+        boxes = other.boxes, capacity = other.capacity;
+        count = other.count, ext = other.ext;
+
+        other.boxes = other.inlineBoxes;
+        other.capacity = InlineBoxes;
+        other.clear();
+    } else {
+        assign(other.boxes, other.count);
+    }
+
+    return *this;
+}
+
+void FireRegion::reserve(int n) {
+    if(n <= capacity)
+        return;
+
+    int cap = std::max(n, capacity * 2);
+    auto buf = new FireBox[cap];
+    std::copy(boxes, boxes + count, buf);
+
+    if(boxes != inlineBoxes)
+        delete[] boxes;
+    boxes = buf, capacity = cap;
+}
+
+void FireRegion::assign(const FireBox *src, int n) {
+    reserve(n);
+    std::copy(src, src + n, boxes);
+    count = n;
+
+    if(!n) {
+        ext = FireBox{0, 0, 0, 0};
+        return;
+    }
+
+    ext = FireBox{src[0].x1, src[0].y1, src[0].x2, src[n - 1].y2};
+    for(int i = 1; i < n; i++)
+        ext.x1 = std::min(ext.x1, src[i].x1),
+        ext.x2 = std::max(ext.x2, src[i].x2);
+}
+
+void FireRegion::clear() {
+    count = 0;
+    ext = FireBox{0, 0, 0, 0};
+}
+
+/* the result is built in regionArena a horizontal slab at a time:
+ * between two consecutive y edges of the two regions, the bands
+ * of this and other (if any) are combined by sweeping their x edges */
+void FireRegion::apply(const FireRegion &other, Op op) {
+    const FireBox *a = boxes, *b = other.boxes;
+    int na = count, nb = other.count;
+
+    auto start = regionArena.mark();
+    size_t prevBand = start, prevSize = 0; // last emitted band
+
+    int ia = 0, ib = 0;
+    int y = INT_MIN;
+
+    while(ia < na || ib < nb) {
+        int aEnd = ia < na ? bandEnd(a, na, ia) : ia;
+        int bEnd = ib < nb ? bandEnd(b, nb, ib) : ib;
+
+        int aTop = ia < na ? a[ia].y1 : INT_MAX;
+        int bTop = ib < nb ? b[ib].y1 : INT_MAX;
+
+        int top = std::max(y, std::min(aTop, bTop));
+        bool aIn = aTop <= top, bIn = bTop <= top;
+
+        int bot = std::min(aIn ? a[ia].y2 : aTop, bIn ? b[ib].y2 : bTop);
+
+        bool needed = (op == OpUnion) ||
+                      (op == OpIntersect && aIn && bIn) ||
+                      (op == OpSubtract && aIn);
+
+        if(needed) {
+            auto band = regionArena.mark();
+
+            int i = aIn ? 2 * ia : 2 * aEnd, ie = 2 * aEnd;
+            int j = bIn ? 2 * ib : 2 * bEnd, je = 2 * bEnd;
+            bool inA = false, inB = false, inside = false;
+            int x1 = 0;
+
+            /* even edges are x1 of a box, odd ones are x2 */
+            while(i < ie || j < je) {
+                int xa = i < ie ? (i & 1 ? a[i / 2].x2 : a[i / 2].x1) : INT_MAX;
+                int xb = j < je ? (j & 1 ? b[j / 2].x2 : b[j / 2].x1) : INT_MAX;
+                int x = std::min(xa, xb);
+
+                if(xa == x) inA = !(i & 1), ++i;
+                if(xb == x) inB = !(j & 1), ++j;
+
+                bool now = op == OpUnion     ? inA || inB :
+                           op == OpIntersect ? inA && inB :
+                                               inA && !inB;
+                if(now == inside)
+                    continue;
+
+                if(now)
+                    x1 = x;
+                else
+                    regionArena.push(FireBox{x1, top, x, bot});
+                inside = now;
+            }
+
+            size_t size = regionArena.mark() - band;
+
+            /* merge with the band above if it has the same boxes */
+            bool merge = size && size == prevSize &&
+                regionArena[prevBand].y2 == top;
+            for(size_t k = 0; merge && k < size; k++)
+                merge = regionArena[prevBand + k].x1 == regionArena[band + k].x1 &&
+                        regionArena[prevBand + k].x2 == regionArena[band + k].x2;
+
+            if(merge) {
+                for(size_t k = 0; k < size; k++)
+                    regionArena[prevBand + k].y2 = bot;
+                regionArena.release(band);
+            } else if(size) {
+                prevBand = band, prevSize = size;
+            }
+        }
+
+        y = bot;
+        if(aIn && a[ia].y2 <= y) ia = aEnd;
+        if(bIn && b[ib].y2 <= y) ib = bEnd;
+
+        if(op != OpUnion && ia >= na)
+            break;
+        if(op == OpIntersect && ib >= nb)
+            break;
+    }
+
+    size_t n = regionArena.mark() - start;
+    assign(n ? &regionArena[start] : nullptr, n);
+    regionArena.release(start);
+}
+
+void FireRegion::unite(const FireRegion &other) {
+    if(other.empty() || this == &other)
+        return;
+
+    if(empty() || (other.count == 1 && boxContains(other.ext, ext))) {
+        *this = other;
+        return;
+    }
+    if(count == 1 && boxContains(ext, other.ext))
+        return;
+
+    apply(other, OpUnion);
+}
+
+void FireRegion::intersect(const FireRegion &other) {
+    if(this == &other)
+        return;
+
+    if(empty() || other.empty() || !boxesOverlap(ext, other.ext)) {
+        clear();
+        return;
+    }
+    if(other.count == 1 && boxContains(other.ext, ext))
+        return;
+
+    apply(other, OpIntersect);
+}
+
+void FireRegion::subtract(const FireRegion &other) {
+    if(this == &other) {
+        clear();
+        return;
+    }
+
+    if(empty() || other.empty() || !boxesOverlap(ext, other.ext))
+        return;
+
+    apply(other, OpSubtract);
+}
+
+void FireRegion::unite(const FireBox &box) {
+    unite(FireRegion(box));
+}
+
+void FireRegion::intersect(const FireBox &box) {
+    intersect(FireRegion(box));
+}
+
+void FireRegion::subtract(const FireBox &box) {
+    subtract(FireRegion(box));
+}
+
+void FireRegion::translate(int dx, int dy) {
+    for(int i = 0; i < count; i++)
+        boxes[i].x1 += dx, boxes[i].y1 += dy,
+        boxes[i].x2 += dx, boxes[i].y2 += dy;
+
+    if(count)
+        ext.x1 += dx, ext.y1 += dy,
+        ext.x2 += dx, ext.y2 += dy;
+}
+
+int64_t FireRegion::area() const {
+    int64_t sum = 0;
+    for(int i = 0; i < count; i++)
+        sum += int64_t(boxes[i].x2 - boxes[i].x1) * (boxes[i].y2 - boxes[i].y1);
+    return sum;
+}
+
+/* greedy: in each step all merges which keep the region banded are
+ * considered and the one with the fewest added pixels per removed box
+ * is done. These are two neighbouring boxes of a band, or two
+ * consecutive bands, united either box by box or into a single box */
+int FireRegion::simplify(int maxBoxes, float maxWaste) {
+    maxBoxes = std::max(maxBoxes, 1);
+    if(count <= maxBoxes)
+        return 0;
+
+    auto start = regionArena.mark();
+    for(int i = 0; i < count; i++)
+        regionArena.push(boxes[i]);
+
+    auto at = [start] (int i) -> FireBox& {
+        return regionArena[start + i];
+    };
+
+    int n = count, merges = 0;
+    auto erase = [&at, &n] (int from, int num) {
+        for(int i = from; i + num < n; i++)
+            at(i) = at(i + num);
+        n -= num;
+    };
+
+    enum MergeType {MergeBoxes, MergeBands, MergeBounding};
+    int64_t waste = 0, allowed = int64_t(maxWaste * area());
+
+    while(n > maxBoxes) {
+        MergeType type = MergeBoxes;
+        int64_t bestCost = 0;
+        double bestScore = -1;
+        int first = 0, second = 0, end = 0;
+
+        auto consider = [&] (MergeType t, int64_t cost, int removed,
+                int f, int s, int e) {
+            double score = double(cost) / removed;
+            if(bestScore < 0 || score < bestScore)
+                type = t, bestCost = cost, bestScore = score,
+                first = f, second = s, end = e;
+        };
+
+        int prev = -1;
+        int64_t prevArea = 0;
+        for(int i = 0, e; i < n; prev = i, i = e) {
+            e = bandEnd(&at(0), n, i);
+
+            int top = at(i).y1, h = at(i).y2 - top;
+            int64_t bandArea = 0;
+            for(int k = i; k < e; k++) {
+                bandArea += int64_t(at(k).x2 - at(k).x1) * h;
+                if(k + 1 < e)
+                    consider(MergeBoxes, int64_t(at(k + 1).x1 - at(k).x2) * h,
+                            1, k, k, k + 1);
+            }
+
+            if(prev >= 0) {
+                int u = 0;
+                int64_t len = 0;
+                uniteBands(&at(prev), i - prev, &at(i), e - i,
+                        [&u, &len] (int x1, int x2) { ++u, len += x2 - x1; });
+
+                int64_t span = at(i).y2 - at(prev).y1;
+                int64_t both = prevArea + bandArea;
+
+                if(e - prev - u > 0)
+                    consider(MergeBands, len * span - both,
+                            e - prev - u, prev, i, e);
+
+                int x1 = std::min(at(prev).x1, at(i).x1);
+                int x2 = std::max(at(i - 1).x2, at(e - 1).x2);
+                consider(MergeBounding, (x2 - x1) * span - both,
+                        e - prev - 1, prev, i, e);
+            }
+
+            prevArea = bandArea;
+        }
+
+        waste += bestCost;
+        if(waste > allowed) {
+            regionArena.release(start);
+            return -1;
+        }
+
+        int y1 = at(first).y1, y2 = at(second).y2;
+        if(type == MergeBoxes) {
+            at(first).x2 = at(end).x2;
+            erase(end, 1);
+        } else if(type == MergeBounding) {
+            int x1 = std::min(at(first).x1, at(second).x1);
+            int x2 = std::max(at(second - 1).x2, at(end - 1).x2);
+            at(first) = FireBox{x1, y1, x2, y2};
+            erase(first + 1, end - first - 1);
+        } else {
+            /* build the united band after the working boxes,
+             * then copy it over the two old bands */
+            auto tail = regionArena.mark();
+            int u = 0;
+            uniteBands(&at(first), second - first, &at(second), end - second,
+                    [&u] (int, int) { ++u; });
+            for(int k = 0; k < u; k++)
+                regionArena.push(FireBox{});
+
+            int k = 0;
+            uniteBands(&at(first), second - first, &at(second), end - second,
+                    [&k, tail, y1, y2] (int x1, int x2) {
+                        regionArena[tail + k++] = FireBox{x1, y1, x2, y2};
+                    });
+
+            for(k = 0; k < u; k++)
+                at(first + k) = regionArena[tail + k];
+            regionArena.release(tail);
+            erase(first + u, end - first - u);
+        }
+
+        /* a merged band can match the band above or below it */
+        n = coalesceBands(&at(0), n);
+        ++merges;
+    }
+
+    assign(&at(0), n);
+    regionArena.release(start);
+    return merges;
+}
+
+bool FireRegion::contains(int x, int y) const {
+    return overlaps(x, y, 1, 1);
+}
+
+bool FireRegion::overlaps(int x, int y, int w, int h) const {
+    FireBox box{x, y, x + w, y + h};
+    if(w <= 0 || h <= 0 || !count || !boxesOverlap(ext, box))
+        return false;
+
+    for(int i = 0; i < count; i++) {
+        if(boxes[i].y2 <= box.y1)
+            continue;
+        if(boxes[i].y1 >= box.y2)
+            break;
+
+        if(boxesOverlap(boxes[i], box))
+            return true;
+    }
+
+    return false;
+}
+
+bool FireRegion::overlaps(const FireRegion &other) const {
+    if(!count || !other.count || !boxesOverlap(ext, other.ext))
+        return false;
+
+    for(auto &box : other) {
+        if(box.y2 <= ext.y1)
+            continue;
+        if(box.y1 >= ext.y2)
+            break;
+
+        if(overlaps(box.x1, box.y1, box.x2 - box.x1, box.y2 - box.y1))
+            return true;
+    }
+
+    return false;
+}
@@ -0,0 +1,52 @@
+#include <resource.hpp>
+#include <core.hpp>
+
+LazyResource::LazyResource(std::function<void()> create,
+        std::function<void()> release) :
+    create(create), release(release) {}
+
+LazyResource::~LazyResource() {
+    cancelTimer();
+    if(created)
+        release();
+}
+
+void LazyResource::cancelTimer() {
+    if(timer == (uint)-1)
+        return;
+
+    core->remTimer(timer);
+    timer = -1;
+}
+
+void LazyResource::acquire() {
+    cancelTimer();
+    ++users;
+
+    if(!created)
+        create(),
+        created = true;
+}
+
+void LazyResource::unref() {
+    if(users == 0 || --users > 0)
+        return;
+
+    timer = core->addTimer(core->getGPUIdleTime(), [=] () {
+        timer = -1;
+        releaseNow();
+    });
+}
+
+void LazyResource::releaseNow() {
+    if(users || !created)
+        return;
+
+    cancelTimer();
+    release();
+    created = false;
+}
+
+bool LazyResource::isCreated() {
+    return created;
+}
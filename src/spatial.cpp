@@ -0,0 +1,65 @@
+#include <spatial.hpp>
+
+FireBox SpatialGrid::cellRange(const FireBox &box) const {
+    auto cell = [] (int v, int origin, int size) {
+        v = (v - origin) / CellSize;
+        return std::max(0, std::min(v, size - 1));
+    };
+
+    int ox = originX - offsetX, oy = originY - offsetY;
+
+    /* x2 and y2 are exclusive */
+    return FireBox{cell(box.x1, ox, cols), cell(box.y1, oy, rows),
+        cell(box.x2 - 1, ox, cols), cell(box.y2 - 1, oy, rows)};
+}
+
+void SpatialGrid::reset(int x, int y, int w, int h) {
+    for(auto &cell : cells)
+        for(auto win : cell)
+            win->inGrid = false;
+
+    originX = x, originY = y;
+    cols = std::max(1, (w + CellSize - 1) / CellSize);
+    rows = std::max(1, (h + CellSize - 1) / CellSize);
+
+    cells.clear();
+    cells.resize(cols * rows);
+}
+
+void SpatialGrid::insert(FireWin *win, const FireBox &bounds) {
+    if(!ready() || bounds.x1 >= bounds.x2 || bounds.y1 >= bounds.y2) {
+        remove(win);
+        return;
+    }
+
+    auto r = cellRange(bounds);
+    auto &old = win->gridCells;
+    if(win->inGrid && old.x1 == r.x1 && old.y1 == r.y1 &&
+            old.x2 == r.x2 && old.y2 == r.y2)
+        return;
+
+    remove(win);
+    for(int y = r.y1; y <= r.y2; y++)
+        for(int x = r.x1; x <= r.x2; x++)
+            cells[y * cols + x].push_back(win);
+
+    win->gridCells = r;
+    win->inGrid = true;
+}
+
+void SpatialGrid::remove(FireWin *win) {
+    if(!win->inGrid)
+        return;
+
+    auto &r = win->gridCells;
+    for(int y = r.y1; y <= r.y2; y++) {
+        for(int x = r.x1; x <= r.x2; x++) {
+            auto &cell = cells[y * cols + x];
+            auto it = std::find(cell.begin(), cell.end(), win);
+            if(it != cell.end())
+                *it = cell.back(), cell.pop_back();
+        }
+    }
+
+    win->inGrid = false;
+}
@@ -0,0 +1,145 @@
+#include <timer.hpp>
+#include <time.h>
+
+uint64_t getTimeMs() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return uint64_t(ts.tv_sec) * 1000 + ts.tv_nsec / 1000000;
+}
+
+TimerWheel::TimerWheel() {
+    current = getTimeMs();
+}
+
+void TimerWheel::insert(Timer t) {
+    if(t.expires < current)
+        t.expires = current;
+
+    uint64_t delta = t.expires - current;
+    constexpr uint64_t maxDelta = (1ull << (LevelBits * Levels)) - 1;
+    if(delta > maxDelta)
+        delta = maxDelta, t.expires = current + maxDelta;
+
+    int level = 0;
+    while(level < Levels - 1 && (delta >> (LevelBits * (level + 1))))
+        level++;
+
+    int slot = (t.expires >> (LevelBits * level)) & LevelMask;
+
+    auto &list = wheel[level][slot];
+    auto id = t.id;
+    list.push_front(std::move(t));
+    count[level]++;
+    timers[id] = TimerPos{level, slot, list.begin()};
+}
+
+void TimerWheel::cascade(int level) {
+    int slot = (current >> (LevelBits * level)) & LevelMask;
+
+    TimerList moved;
+    moved.splice(moved.end(), wheel[level][slot]);
+    count[level] -= moved.size();
+
+    for(auto &t : moved)
+        insert(std::move(t));
+
+    if(slot == 0 && level + 1 < Levels)
+        cascade(level + 1);
+}
+
+void TimerWheel::add(uint id, int timeout, TimerCallback action) {
+    remove(id);
+
+    /* the slot of current is already processed, a timer
+     * put there would fire only after the wheel wraps */
+    auto now = std::max(current, getTimeMs());
+    insert(Timer{id, std::max(now + std::max(timeout, 0), current + 1),
+            action});
+}
+
+void TimerWheel::remove(uint id) {
+    auto it = timers.find(id);
+    if(it == timers.end())
+        return;
+
+    auto pos = it->second;
+    wheel[pos.level][pos.slot].erase(pos.it);
+    count[pos.level]--;
+    timers.erase(it);
+}
+
+bool TimerWheel::exists(uint id) {
+    return timers.find(id) != timers.end();
+}
+
+bool TimerWheel::empty() {
+    return timers.empty();
+}
+
+int TimerWheel::advance(uint64_t now) {
+    int run = 0;
+
+    while(current < now) {
+        if(timers.empty()) {
+            current = now;
+            break;
+        }
+
+        /* nothing to run on level 0, skip to the next cascade */
+        if(!count[0]) {
+            auto last = current | LevelMask;
+            if(last >= now) {
+                current = now;
+                break;
+            }
+            current = last;
+        }
+
+        ++current;
+        int slot = current & LevelMask;
+        if(slot == 0)
+            cascade(1);
+
+        /* a timer's action can add or remove other timers,
+         * so take them out one at a time */
+        auto &list = wheel[0][slot];
+        while(!list.empty()) {
+            auto t = std::move(list.front());
+            list.pop_front();
+            count[0]--;
+            timers.erase(t.id);
+
+            t.action();
+            ++run;
+        }
+    }
+
+    return run;
+}
+
+int TimerWheel::nextTimeout() {
+    if(timers.empty())
+        return -1;
+
+    /* on each level, the first non-empty slot after current
+     * holds the level's earliest timers */
+    uint64_t next = UINT64_MAX;
+    for(int level = 0; level < Levels; level++) {
+        if(!count[level])
+            continue;
+
+        auto pos = current >> (LevelBits * level);
+        for(int i = 1; i <= LevelSize; i++) {
+            auto &list = wheel[level][(pos + i) & LevelMask];
+            if(list.empty())
+                continue;
+
+            for(auto &t : list)
+                next = std::min(next, t.expires);
+            break;
+        }
+    }
+
+    auto now = getTimeMs();
+    return next > now ? next - now : 0;
+}
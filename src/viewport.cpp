@@ -0,0 +1,135 @@
+#include <viewport.hpp>
+#include <opengl.hpp>
+
+/* like Core::damageRegion */
+#define MaxViewportBoxes 16
+#define MaxViewportWaste 0.5f
+
+namespace {
+    int floorDiv(int a, int b) {
+        return a >= 0 ? a / b : -((b - 1 - a) / b);
+    }
+}
+
+ViewportCache::ViewportCache() :
+    textures(std::bind(std::mem_fn(&ViewportCache::createTextures), this),
+             std::bind(std::mem_fn(&ViewportCache::releaseTextures), this)) {}
+
+void ViewportCache::createTextures() {
+    GetTuple(w, h, core->getWorksize());
+    GetTuple(s, t, core->getScreenSize());
+    vw = w, vh = h, sw = s, sh = t;
+
+    entries.resize(vw * vh);
+    for(auto &e : entries)
+        OpenGL::prepareFramebuffer(e.fbuff, e.texture),
+        e.damage = FireRegion(0, 0, sw, sh);
+
+    /* framebuffer textures are upside down */
+    OpenGL::generateVAOVBO(0, sh, sw, -sh, vao, vbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void ViewportCache::releaseTextures() {
+    for(auto &e : entries)
+        glDeleteFramebuffers(1, &e.fbuff),
+        glDeleteTextures(1, &e.texture);
+
+    entries.clear();
+
+    glDeleteBuffers(1, &vbo);
+    glDeleteVertexArrays(1, &vao);
+}
+
+void ViewportCache::acquire() {
+    ++users;
+    textures.acquire();
+}
+
+void ViewportCache::unref() {
+    --users;
+
+    /* the cache is shared, so the idle timer must not belong to the
+     * plugin calling this, or unloading it would remove the timer */
+    OwnerScope scope(nullptr);
+    textures.unref();
+}
+
+void ViewportCache::damageViewport(Entry &e, FireRegion &&r) {
+    e.damage.unite(r);
+    if(e.damage.simplify(MaxViewportBoxes, MaxViewportWaste) < 0)
+        e.damage = FireRegion(0, 0, sw, sh);
+}
+
+void ViewportCache::damage(const FireRegion &r) {
+    if(entries.empty() || r.empty())
+        return;
+
+    GetTuple(vx, vy, core->getWorkspace());
+    auto &ext = r.extents();
+
+    /* viewports touched by r, relative to the current one */
+    int x1 = std::max(-vx, floorDiv(ext.x1, sw));
+    int y1 = std::max(-vy, floorDiv(ext.y1, sh));
+    int x2 = std::min(vw - 1 - vx, floorDiv(ext.x2 - 1, sw));
+    int y2 = std::min(vh - 1 - vy, floorDiv(ext.y2 - 1, sh));
+
+    for(int j = y1; j <= y2; j++) {
+        for(int i = x1; i <= x2; i++) {
+            FireRegion part = r;
+            part.intersect(FireBox{i * sw, j * sh, (i + 1) * sw, (j + 1) * sh});
+            if(part.empty())
+                continue;
+
+            part.translate(-i * sw, -j * sh);
+            damageViewport(entries[(vy + j) * vw + vx + i], std::move(part));
+        }
+    }
+}
+
+void ViewportCache::damageAll() {
+    for(auto &e : entries)
+        e.damage = FireRegion(0, 0, sw, sh);
+}
+
+GLuint ViewportCache::getTexture(std::tuple<int, int> vp) {
+    GetTuple(x, y, vp);
+    if(entries.empty() || x < 0 || y < 0 || x >= vw || y >= vh)
+        return -1;
+
+    auto &e = entries[y * vw + x];
+
+    /* someone draws everything without reporting damage */
+    if(FireWin::allDamaged)
+        e.damage = FireRegion(0, 0, sw, sh);
+
+    if(e.damage.empty()) {
+        ++stats.hits;
+        return e.texture;
+    }
+
+    if(e.damage.size() == 1 && e.damage.extents().x1 == 0 &&
+            e.damage.extents().y1 == 0 && e.damage.extents().x2 == sw &&
+            e.damage.extents().y2 == sh)
+        ++stats.full;
+    else
+        ++stats.partial;
+
+    core->renderViewport(vp, e.fbuff, e.damage);
+    e.damage.clear();
+
+    return e.texture;
+}
+
+void ViewportCache::draw(std::tuple<int, int> vp, const glm::mat4 &transform) {
+    GetTuple(x, y, vp);
+    if(entries.empty() || x < 0 || y < 0 || x >= vw || y >= vh)
+        return;
+
+    /* the alpha of the texture is meaningless */
+    int saveDepth = OpenGL::depth;
+    OpenGL::depth = 24;
+    OpenGL::renderTextureMVP(entries[y * vw + x].texture, vao, vbo,
+            transform);
+    OpenGL::depth = saveDepth;
+}
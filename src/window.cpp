@@ -1,6 +1,10 @@
 #include <core.hpp>
 #include <opengl.hpp>
 
+#ifdef __SSE__
+#include <xmmintrin.h>
+#endif
+
 
 /* misc definitions */
 
@@ -26,26 +30,12 @@ Atom wmNameAtom;
 Atom winOpacityAtom;
 Atom clientListAtom;
 
-glm::mat4 Transform::grot;
-glm::mat4 Transform::gscl;
-glm::mat4 Transform::gtrs;
-
-Region copyRegion(Region reg) {
-    if(!reg) {
-        auto tmp = XCreateRegion();
-        std::memset(tmp, 0, sizeof(REGION));
-        tmp->numRects = 1;
-        return tmp;
-    }
+uint64_t TrackedMatrix::counter = 0;
 
-    Region newreg = XCreateRegion();
-    newreg->rects = new BOX[reg->numRects];
-    newreg->size = reg->size;
-    newreg->numRects = reg->numRects;
-    newreg->extents = reg->extents;
-    std::memcpy(newreg->rects, reg->rects, reg->numRects * sizeof(BOX));
-    return newreg;
-}
+TrackedMatrix Transform::grot;
+TrackedMatrix Transform::gscl;
+TrackedMatrix Transform::gtrs;
+TrackedMatrix Transform::gviewport;
 
 Transform::Transform() {
     this->translation = glm::mat4();
@@ -53,62 +43,160 @@ Transform::Transform() {
     this->scalation = glm::mat4();
 }
 
-glm::mat4 Transform::compose() {
-    return (gtrs*translation)*(grot*rotation)*(gscl*scalation);
+glm::mat4 multiplyMatrices(const glm::mat4 &a, const glm::mat4 &b) {
+#ifdef __SSE__
+    /* column j of the result is a's columns weighted by b[j] */
+    __m128 col[4];
+    for(int i = 0; i < 4; i++)
+        col[i] = _mm_loadu_ps(&a[i][0]);
+
+    glm::mat4 r;
+    for(int j = 0; j < 4; j++) {
+        __m128 sum = _mm_mul_ps(col[0], _mm_set1_ps(b[j][0]));
+        sum = _mm_add_ps(sum, _mm_mul_ps(col[1], _mm_set1_ps(b[j][1])));
+        sum = _mm_add_ps(sum, _mm_mul_ps(col[2], _mm_set1_ps(b[j][2])));
+        sum = _mm_add_ps(sum, _mm_mul_ps(col[3], _mm_set1_ps(b[j][3])));
+        _mm_storeu_ps(&r[j][0], sum);
+    }
+    return r;
+#else
+    return a * b;
+#endif
 }
 
-Region output;
+const glm::mat4& Transform::compose() {
+    uint64_t v = std::max({grot.version(), gscl.version(), gtrs.version(),
+            gviewport.version(), rotation.version(), scalation.version(),
+            translation.version(), viewport.version()});
+
+    if(v != modelVersion) {
+        auto t = multiplyMatrices(gtrs, translation);
+        auto r = multiplyMatrices(grot, rotation);
+        auto s = multiplyMatrices(gscl, scalation);
+        auto vp = multiplyMatrices(gviewport, viewport);
+        model = multiplyMatrices(multiplyMatrices(t, r),
+                multiplyMatrices(s, vp));
+        modelVersion = v;
+    }
+    return model;
+}
+
+const glm::mat4& Transform::getMVP() {
+    compose();
+    if(mvpVersion != modelVersion || mvpTransformed != OpenGL::transformed) {
+        mvp = OpenGL::transformed ?
+            multiplyMatrices(OpenGL::getProjView(), model) : model;
+        mvpVersion = modelVersion;
+        mvpTransformed = OpenGL::transformed;
+    }
+    return mvp;
+}
+
+FireRegion output;
 bool FireWin::allDamaged = false;
+std::vector<FireWin*> FireWin::dirtyWindows;
 
 
 FireWin::FireWin(Window id, bool init) {
     this->id = id;
+    GetTuple(vx, vy, core->getWorkspace());
+    setViewport(vx, vy);
     if(!init) return;
 
-    auto status = XGetWindowAttributes(core->d, id, &attrib);
-    if(status != Success)
-        norender = true;
-
-    XSizeHints hints;
-    long flags;
-    XGetWMNormalHints(core->d, id, &hints, &flags);
-
-    if(flags & USPosition)
-        attrib.x = hints.x,
-        attrib.y = hints.y;
+    auto cookies = WinUtil::requestWindowInfo(id);
+    this->init(cookies);
+}
 
-    if(flags & USSize)
-        attrib.width = hints.width,
-        attrib.height= hints.height;
+FireWin::FireWin(WindowCookies &cookies) {
+    this->id = cookies.id;
+    GetTuple(vx, vy, core->getWorkspace());
+    setViewport(vx, vy);
+    init(cookies);
+}
 
-    else if(flags & PBaseSize)
-        attrib.width = hints.base_width,
-        attrib.height = hints.base_height;
+void FireWin::init(WindowCookies &cookies) {
+    auto c = core->xconn;
+
+    auto attribReply   = WinUtil::getReply(c, cookies.attrib, xcb_get_window_attributes_reply);
+    auto geometryReply = WinUtil::getReply(c, cookies.geometry, xcb_get_geometry_reply);
+    auto hintsReply    = WinUtil::getReply(c, cookies.hints, xcb_get_property_reply);
+    auto opacityReply  = WinUtil::getReply(c, cookies.opacity, xcb_get_property_reply);
+
+    xcb_get_property_reply_t *typeReply = NULL, *transReply = NULL,
+                             *leaderReply = NULL, *stateReply = NULL;
+    if(!cookies.saved)
+        typeReply   = WinUtil::getReply(c, cookies.type, xcb_get_property_reply),
+        transReply  = WinUtil::getReply(c, cookies.transient, xcb_get_property_reply),
+        leaderReply = WinUtil::getReply(c, cookies.leader, xcb_get_property_reply),
+        stateReply  = WinUtil::getReply(c, cookies.state, xcb_get_property_reply);
+
+    WinUtil::getAttrib(attrib, attribReply, geometryReply);
+
+    /* window is not drawn until it is mapped, see syncAttrib() */
+    norender = true;
+
+    /* WM_NORMAL_HINTS is an array of 18 CARD32,
+     * flags first, then x, y, width, height, ...
+     * base_width and base_height are at 15 and 16 */
+    if(hintsReply && xcb_get_property_value_length(hintsReply) >= 5 * 4) {
+        auto hints = (uint32_t*) xcb_get_property_value(hintsReply);
+        int len = xcb_get_property_value_length(hintsReply) / 4;
+        long flags = hints[0];
+
+        if(flags & USPosition)
+            attrib.x = int32_t(hints[1]),
+            attrib.y = int32_t(hints[2]);
+
+        if(flags & USSize)
+            attrib.width = hints[3],
+            attrib.height= hints[4];
+
+        else if(flags & PBaseSize && len >= 17)
+            attrib.width = hints[15],
+            attrib.height = hints[16];
+    }
 
     updateRegion();
 
+    /* the window might be destroyed before we get to it */
+    core->ignoreErrorsStart();
+
     if(attrib.c_class == InputOutput)
         damagehnd = XDamageCreate(core->d, id, XDamageReportRawRectangles);
     else
         attrib.map_state = IsUnmapped,
         damagehnd = None;
 
-    type         = WinUtil::getWindowType(id);
-    transientFor = WinUtil::getTransient(id);
-    leader       = WinUtil::getClientLeader(id);
-    state        = WinUtil::getWindowState(id);
+    /* transient and leader of restored windows
+     * are set when all of them are created */
+    if(cookies.saved)
+        type  = WindowType(cookies.saved->type),
+        state = cookies.saved->state;
+    else
+        type         = WinUtil::getWindowType(typeReply),
+        transientFor = WinUtil::getTransient(transReply),
+        leader       = WinUtil::getClientLeader(id, leaderReply),
+        state        = WinUtil::getWindowState(stateReply);
     updateState();
 
-    XSelectInput(core->d, id,   FocusChangeMask  |
-                PropertyChangeMask | EnterWindowMask);
-
     XGrabButton (core->d, AnyButton, AnyModifier, id, TRUE,
             ButtonPressMask | ButtonReleaseMask | Button1MotionMask,
             GrabModeSync, GrabModeSync, None, None);
 
     transform.color = glm::vec4(1., 1., 1., 1.);
     transform.color[3] =
-        WinUtil::readProp(id, winOpacityAtom, 0xffff) / 0xffff;
+        WinUtil::readProp(opacityReply, 0xffff) / float(0xffff);
+
+    core->ignoreErrorsEnd();
+
+    free(attribReply);
+    free(geometryReply);
+    free(hintsReply);
+    free(typeReply);
+    free(transReply);
+    free(leaderReply);
+    free(stateReply);
+    free(opacityReply);
 
     glGenTextures(1, &texture);
     keepCount = 0;
@@ -120,8 +208,7 @@ FireWin::~FireWin() {
     glDeleteVertexArrays(1, &vao);
 
     for(auto d : data)
-        delete d.second;
-    data.clear();
+        delete d;
 }
 
 #define Mod(x,m) (((x)%(m)+(m))%(m))
@@ -139,14 +226,25 @@ void FireWin::updateVBO() {
 }
 
 void FireWin::updateRegion() {
-    if(region)
-        XDestroyRegion(region);
-
-    region = core->getRegionFromRect( attrib.x, attrib.y,
+    region = core->getRegionFromRect(attrib.x, attrib.y,
             attrib.x + attrib.width, attrib.y + attrib.height);
+    markDirty();
+}
+
+void FireWin::markDirty() {
+    /* windows which are not in the render list
+     * get their entry when it is rebuilt */
+    if(renderDirty || renderIndex < 0)
+        return;
+
+    renderDirty = true;
+    dirtyWindows.push_back(this);
 }
 
 void FireWin::updateState() {
+    markDirty();
+    core->markStateDirty();
+
     GetTuple(sw, sh, core->getScreenSize());
     if(state & WindowStateMaxH) {
         if(attrib.width != sw)
@@ -173,8 +271,25 @@ void FireWin::updateState() {
 }
 
 void FireWin::syncAttrib() {
+    syncAttrib(xcb_get_window_attributes(core->xconn, id),
+            xcb_get_geometry(core->xconn, id));
+}
+
+void FireWin::syncAttrib(xcb_get_window_attributes_cookie_t attribCookie,
+        xcb_get_geometry_cookie_t geometryCookie) {
+
+    auto attribReply =
+        WinUtil::getReply(core->xconn, attribCookie, xcb_get_window_attributes_reply);
+    auto geometryReply =
+        WinUtil::getReply(core->xconn, geometryCookie, xcb_get_geometry_reply);
+
     XWindowAttributes xwa;
-    XGetWindowAttributes(core->d, id, &xwa);
+    bool status = WinUtil::getAttrib(xwa, attribReply, geometryReply);
+    free(attribReply);
+    free(geometryReply);
+
+    if(!status) // window is already gone
+        return;
 
     bool mask = false;
 
@@ -189,6 +304,7 @@ void FireWin::syncAttrib() {
     if(attrib.map_state == IsViewable &&
             attrib.c_class != InputOnly)
         this->norender = false;
+    markDirty();
 
     if(!mask) return;
 
@@ -201,13 +317,10 @@ void FireWin::syncAttrib() {
     addDamage();
 }
 
-bool FireWin::isVisible() {
+bool FireWin::isRenderable() {
     if(destroyed && !keepCount)
         return false;
 
-    if(!visible && !allDamaged)
-        return false;
-
     if(norender || (state & WindowStateHidden))
         return false;
 
@@ -216,52 +329,54 @@ bool FireWin::isVisible() {
     return true;
 }
 
+bool FireWin::isVisible() {
+    if(!visible && !allDamaged)
+        return false;
+
+    return isRenderable();
+}
+
 bool FireWin::shouldBeDrawn() {
     if(!isVisible())
         return false;
 
-    auto result = XRectInRegion(core->dmg, attrib.x, attrib.y,
+    return core->dmg.overlaps(attrib.x, attrib.y,
             attrib.width, attrib.height);
-
-    if(result == RectangleOut)
-        return false;
-    else
-        return true;
 }
 
 int FireWin::setTexture() {
-    XGrabServer(core->d);
-
     if(attrib.map_state != IsViewable && !keepCount) {
         std::cout << "Invisible window " << id << std::endl;
         norender = true;
-        XUngrabServer(core->d);
+        markDirty();
         return 0;
     }
 
     if(!damaged)  {
         glBindTexture(GL_TEXTURE_2D, texture);
-        XUngrabServer(core->d);
         return 1;
     }
 
     glDeleteTextures(1, &texture);
 
+    /* no server grab: if the window disappears meanwhile
+     * we just get an error for the image request */
+    core->ignoreErrorsStart();
     if(pixmap == 0)
         pixmap = XCompositeNameWindowPixmap(core->d, id);
 
     texture = GLXUtils::textureFromPixmap(pixmap,
             attrib.width, attrib.height, &shared);
+    core->ignoreErrorsEnd();
 
-    XUngrabServer(core->d);
     return 1;
 }
 
 void FireWin::render() {
     OpenGL::color = transform.color;
     if(type == WindowTypeDesktop){
-        OpenGL::renderTransformedTexture(texture, vao, vbo,
-                transform.compose());
+        OpenGL::renderTextureMVP(texture, vao, vbo,
+                transform.getMVP());
         return;
     }
 
@@ -275,41 +390,138 @@ void FireWin::render() {
         updateVBO();
 
     OpenGL::depth = attrib.depth;
-    OpenGL::renderTransformedTexture(texture, vao, vbo,
-            transform.compose());
+    OpenGL::renderTextureMVP(texture, vao, vbo,
+            transform.getMVP());
 
     std::vector<EffectHook*> hooksToRun;
     for(auto h : effects)
         if(h.second->getState())
             hooksToRun.push_back(h.second);
 
-    for(auto h : hooksToRun)
+    for(auto h : hooksToRun) {
+        OwnerScope scope(h->owner);
         h->action();
+    }
+}
+
+void FireWin::setViewport(int x, int y) {
+    vpX = x, vpY = y;
+    core->markStateDirty();
+    transform.viewport = glm::translate(glm::mat4(),
+            glm::vec3(2 * x, -2 * y, 0));
+}
+
+std::tuple<int, int> FireWin::getViewportOffset() {
+    GetTuple(vx, vy, core->getWorkspace());
+    GetTuple(sw, sh, core->getScreenSize());
+    return std::make_tuple((vpX - vx) * sw, (vpY - vy) * sh);
+}
+
+FireRegion FireWin::getScreenRegion() {
+    GetTuple(dx, dy, getViewportOffset());
+    FireRegion r = region;
+    r.translate(dx, dy);
+    return r;
+}
+
+const FireBox& FireWin::getTransformedBox() {
+    FireBox geom = {attrib.x, attrib.y, attrib.width, attrib.height};
+
+    auto &mvp = transform.getMVP();
+    if(transformedVersion == transform.version() &&
+            transformedProj == OpenGL::transformed &&
+            !std::memcmp(&geom, &transformedFrom, sizeof(geom)))
+        return transformedBox;
+
+    transformedFrom = geom;
+    transformedVersion = transform.version();
+    transformedProj = OpenGL::transformed;
+
+    GetTuple(sw, sh, core->getScreenSize());
+    float w2 = sw / 2.f, h2 = sh / 2.f;
+
+    /* the corners as in updateVBO() and the vertex shader */
+    float xs[] = {float(attrib.x), float(attrib.x + attrib.width)};
+    float ys[] = {float(attrib.y), float(attrib.y + attrib.height)};
+
+    float minx = 1e9, miny = 1e9, maxx = -1e9, maxy = -1e9;
+    for(auto x : xs) {
+        for(auto y : ys) {
+            auto p = mvp * glm::vec4((x - w2) / w2, (h2 - y) / h2, 0, 1);
+
+            /* behind the camera, nothing can be said */
+            if(p.w <= 1e-6) {
+                transformedBox = {INT_MIN / 2, INT_MIN / 2,
+                    INT_MAX / 2, INT_MAX / 2};
+                return transformedBox;
+            }
+
+            float sx = (p.x / p.w + 1) * w2;
+            float sy = (1 - p.y / p.w) * h2;
+            minx = std::min(minx, sx), maxx = std::max(maxx, sx);
+            miny = std::min(miny, sy), maxy = std::max(maxy, sy);
+        }
+    }
+
+    /* an untransformed window must get exactly its geometry */
+    transformedBox = {int(std::floor(minx + 1e-3f)),
+        int(std::floor(miny + 1e-3f)),
+        int(std::ceil(maxx - 1e-3f)), int(std::ceil(maxy - 1e-3f))};
+    return transformedBox;
+}
+
+void FireWin::damageTransformed() {
+    if(norender)
+        return;
+
+    GetTuple(dx, dy, getViewportOffset());
+    FireBox geom = {attrib.x + dx, attrib.y + dy,
+        attrib.x + dx + attrib.width, attrib.y + dy + attrib.height};
+
+    FireRegion r(transformMoved ? damagedBox : geom);
+    FireBox box = getTransformedBox();
+    r.unite(box);
+
+    transformMoved = std::memcmp(&box, &geom, sizeof(box)) != 0;
+    damagedBox = box;
+
+    /* the render list has to know where the window is now */
+    markDirty();
+    core->damageRegion(r);
+}
+
+void FireWin::syncViewport() {
+    GetTuple(vx, vy, core->getWorkspace());
+    if(vpX == vx && vpY == vy)
+        return;
+
+    GetTuple(dx, dy, getViewportOffset());
+    setViewport(vx, vy);
+    move(attrib.x + dx, attrib.y + dy);
 }
 
 void FireWin::move(int x, int y, bool configure) {
-    bool existPreviousRegion = !(region == nullptr);
+    /* x and y are relative to the current viewport. Positions
+     * reported by the server (!configure) are where the window is
+     * in X, so they are relative to the window's own viewport */
+    if(configure)
+        syncViewport();
 
-    Region prevRegion = nullptr;
-    if(existPreviousRegion)
-        prevRegion = copyRegion(region);
+    /* an unsynced window is drawn off its position in X */
+    FireRegion prevRegion = getScreenRegion();
 
     int dx = x - attrib.x,
         dy = y - attrib.y;
 
-    SignalListenerData d;
-    d.push_back((void*)(this));
-    d.push_back((void*)(&dx));
-    d.push_back((void*)(&dy));
-    core->triggerSignal("move-window", d);
+    MoveWindowSignal data(this, dx, dy);
+    core->triggerSignal(core->moveWindowSignal, data);
 
     attrib.x = x;
     attrib.y = y;
     updateRegion();
 
-    if(existPreviousRegion)
-        core->damageRegion(prevRegion);
-    core->damageRegion(region);
+    core->damageRegion(prevRegion);
+    core->damageRegion(getScreenRegion());
 
     if(type == WindowTypeDesktop) {
         glDeleteBuffers(1, &vbo);
@@ -336,17 +548,13 @@ void FireWin::resize(int w, int h, bool configure) {
 
     if(w <= 0 || h <= 0) return;
 
-    bool existPreviousRegion = !(region == nullptr);
-    Region prevRegion = nullptr;
-    if(existPreviousRegion)
-         prevRegion = copyRegion(region);
+    FireRegion prevRegion = region;
 
     attrib.width  = w;
     attrib.height = h;
     updateRegion();
 
-    if(existPreviousRegion)
-        core->damageRegion(prevRegion);
+    core->damageRegion(prevRegion);
     core->damageRegion(region);
 
     if(!disableVBOChange)
@@ -371,10 +579,12 @@ void FireWin::resize(int w, int h, bool configure) {
         shared.existing = false;
         shared.init = true;
     }
+    core->ignoreErrorsStart();
     if(pixmap)
         XFreePixmap(core->d, pixmap);
     if(attrib.map_state == IsViewable)
         pixmap = XCompositeNameWindowPixmap(core->d, id);
+    core->ignoreErrorsEnd();
 }
 
 void FireWin::moveResize(int x, int y, int w, int h) {
@@ -395,7 +605,7 @@ void FireWin::addDamage() {
         return;
 
     damaged = true;
-    if(!region) {
+    if(region.empty()) {
         XserverRegion reg =
         XFixesCreateRegionFromWindow(core->d, id, WindowRegionBounding);
 
@@ -412,6 +622,8 @@ void FireWin::getInputFocus() {
     if(attrib.map_state != IsViewable)
         return;
 
+    /* a focused client often asks where it is, e.g. to place menus */
+    syncViewport();
     XSetInputFocus(core->d, id, RevertToPointerRoot, CurrentTime);
     XChangeProperty ( core->d, core->root, activeWinAtom,
             XA_WINDOW, 32, PropModeReplace,
@@ -446,56 +658,114 @@ namespace WinUtil {
         return false;
     }
 
-#define uchar unsigned char
-    int readProp(Window win, Atom prop, int def) {
-        Atom      actual;
-        int       result, format;
-        ulong n, left;
-        uchar *data;
-
-        result = XGetWindowProperty (core->d, win, prop,
-                0L, 1L, FALSE, XA_CARDINAL, &actual, &format,
-                &n, &left, &data);
-
-        if (result == Success && data) {
-            if (n)
-                result = *(int *)data,
-                       result >>= 16;
-            XFree(data);
+    WindowCookies requestWindowInfo(Window win, SavedWindow *saved) {
+        auto c = core->xconn;
+
+        /* select input before requesting properties,
+         * so that we do not miss changes after the requests */
+        core->ignoreErrorsStart();
+        XSelectInput(core->d, win, FocusChangeMask  |
+                PropertyChangeMask | EnterWindowMask);
+        core->ignoreErrorsEnd();
+
+        WindowCookies cookies;
+        cookies.id        = win;
+        cookies.attrib    = xcb_get_window_attributes(c, win);
+        cookies.geometry  = xcb_get_geometry(c, win);
+        cookies.hints     = xcb_get_property(c, 0, win,
+                XA_WM_NORMAL_HINTS, XA_WM_SIZE_HINTS, 0, 18);
+
+        cookies.opacity   = requestProperty(win, winOpacityAtom);
+
+        cookies.saved = saved;
+        if(saved)
+            return cookies;
+
+        cookies.type      = requestProperty(win, winTypeAtom);
+        cookies.transient = requestProperty(win, XA_WM_TRANSIENT_FOR);
+        cookies.leader    = requestProperty(win, wmClientLeaderAtom);
+        cookies.state     = requestProperty(win, winStateAtom);
+        return cookies;
+    }
+
+    bool getAttrib(XWindowAttributes &xwa,
+            xcb_get_window_attributes_reply_t *attribReply,
+            xcb_get_geometry_reply_t *geometryReply) {
+
+        std::memset(&xwa, 0, sizeof(xwa));
+        if(!attribReply || !geometryReply)
+            return false;
+
+        xwa.x            = geometryReply->x;
+        xwa.y            = geometryReply->y;
+        xwa.width        = geometryReply->width;
+        xwa.height       = geometryReply->height;
+        xwa.border_width = geometryReply->border_width;
+        xwa.depth        = geometryReply->depth;
+        xwa.root         = geometryReply->root;
+
+        xwa.c_class           = attribReply->_class;
+        xwa.map_state         = attribReply->map_state;
+        xwa.override_redirect = attribReply->override_redirect;
+        xwa.bit_gravity       = attribReply->bit_gravity;
+        xwa.win_gravity       = attribReply->win_gravity;
+        xwa.colormap          = attribReply->colormap;
+        return true;
+    }
+
+    xcb_get_property_cookie_t requestProperty(Window win, Atom prop) {
+        Atom type = XCB_GET_PROPERTY_TYPE_ANY;
+        uint32_t len = 1;
+
+        if(prop == winStateAtom)
+            type = XA_ATOM, len = 1024;
+        else if(prop == winTypeAtom)
+            type = XA_ATOM;
+        else if(prop == XA_WM_TRANSIENT_FOR || prop == wmClientLeaderAtom)
+            type = XA_WINDOW;
+        else if(prop == winOpacityAtom)
+            type = XA_CARDINAL;
+
+        return xcb_get_property(core->xconn, 0, win, prop, type, 0, len);
+    }
+
+    namespace {
+        /* returns the number of 32-bit items in reply */
+        int getItems32(xcb_get_property_reply_t *reply, uint32_t *&data) {
+            if(!reply || reply->format != 32)
+                return 0;
+
+            data = (uint32_t*) xcb_get_property_value(reply);
+            return xcb_get_property_value_length(reply) / 4;
         }
-        else
-            result = def;
-        return result;
     }
 
-    FireWindow getClientLeader(Window win) {
-        unsigned long nitems = 0;
-        unsigned char* data = 0;
-        Atom actual_type;
-        int actual_format;
-        unsigned long bytes;
-
-        int status = XGetWindowProperty (core->d, win,
-                wmClientLeaderAtom, 0L, 1L, False,
-                XA_WINDOW, &actual_type, &actual_format,
-                &nitems, &bytes, &data);
-        if (status != Success || actual_type == None || data == NULL)
+    int readProp(xcb_get_property_reply_t *reply, int def) {
+        uint32_t *data;
+        if(!getItems32(reply, data))
+            return def;
+
+        return data[0] >> 16;
+    }
+
+    FireWindow getClientLeader(Window win, xcb_get_property_reply_t *reply) {
+        uint32_t *data;
+        if(!getItems32(reply, data))
             return nullptr;
-        auto x = *reinterpret_cast<Window*> (data);
+
+        Window x = data[0];
         if ( x == 0 || x == win )
             return nullptr;
 
         return core->findWindow(x);
     }
 
-    FireWindow getTransient(Window win) {
-
-        Window dumm;
-        auto status = XGetTransientForHint(core->d, win, &dumm);
-        if ( status == 0 || dumm == 0 )
+    FireWindow getTransient(xcb_get_property_reply_t *reply) {
+        uint32_t *data;
+        if(!getItems32(reply, data) || data[0] == 0)
             return nullptr;
-        else
-            return core->findWindow(dumm);
+
+        return core->findWindow(data[0]);
     }
 
     void getWindowName(Window win, char *name) {
@@ -510,23 +780,12 @@ namespace WinUtil {
         }
     }
 
-    WindowType getWindowType(Window win) {
-        Atom      actual, a = None;
-        int       result, format;
-        ulong n, left;
-        unsigned char *data;
-
-        result = XGetWindowProperty (core->d, win, winTypeAtom,
-                0L, 1L, FALSE, XA_ATOM, &actual, &format,
-                &n, &left, &data);
-
-        if(result == Success && data) {
-            if(n)
-                std::memcpy (&a, data, sizeof (Atom));
-            XFree((void*) data);
-        }
-        else return WindowTypeUnknown;
+    WindowType getWindowType(xcb_get_property_reply_t *reply) {
+        uint32_t *data;
+        if(!getItems32(reply, data))
+            return WindowTypeUnknown;
 
+        Atom a = data[0];
         if (a) {
             if (a == winTypeNormalAtom)
                 return WindowTypeNormal;
@@ -591,26 +850,14 @@ namespace WinUtil {
         return WindowStateBase;
     }
 
-    uint getWindowState(Window win) {
-        Atom      actual;
-        int       result, format;
-        ulong n, left;
-        unsigned char *data;
-        uint  state = WindowStateBase;
+    uint getWindowState(xcb_get_property_reply_t *reply) {
+        uint32_t *data;
+        int n = getItems32(reply, data);
+        uint state = WindowStateBase;
 
-        result = XGetWindowProperty (core->d, win, winStateAtom,
-                0L, 1024L, FALSE, XA_ATOM, &actual, &format,
-                &n, &left, &data);
+        for(int i = 0; i < n; i++)
+            state |= getStateMask(data[i]);
 
-        if (result == Success && data) {
-            Atom *a = (Atom*)data;
-
-            while(n--)
-                state |= getStateMask(*a++);
-
-            XFree((void*)data);
-        }
-        std::cout << "Returning state" << state << std::endl;
         return state;
     }
 
@@ -5,20 +5,145 @@
 
 std::unordered_map<Window, FireWindow> windows;
 
-using StackIterator = std::list<FireWindow>::iterator;
 WinStack::WinStack() {
-    layers.resize(3);
 }
 
-void WinStack::addWindow(FireWindow win) {
-    if(findWindow(win->id) != nullptr &&
-            win->type != WindowTypeDesktop) {
+void WinStack::link(FireWin *win, Layer layer, FireWin *pos) {
+    win->layer = layer;
+    layers[layer].link(win, pos);
+
+    renderList.rebuild = true;
+    core->markStateDirty();
+}
+
+void WinStack::unlink(FireWin *win) {
+    layers[win->layer].unlink(win);
+
+    win->renderIndex = -1;
+    win->renderDirty = false;
+    renderList.rebuild = true;
+    core->markStateDirty();
+}
+
+namespace {
+    /* where the window is drawn, relative to the current viewport */
+    FireBox getDrawnBox(FireWin *w) {
+        auto &a = w->attrib;
+        GetTuple(dx, dy, w->getViewportOffset());
+        FireBox box = {a.x + dx, a.y + dy,
+            a.x + dx + a.width, a.y + dy + a.height};
+
+        if(w->transformMoved) {
+            auto &t = w->damagedBox;
+            box = {std::min(box.x1, t.x1), std::min(box.y1, t.y1),
+                std::max(box.x2, t.x2), std::max(box.y2, t.y2)};
+        }
+        return box;
+    }
+}
+
+void WinStack::updateRenderEntry(int i) {
+    auto &rl = renderList;
+    auto w = rl.wins[i];
+
+    if(w->attrib.depth == 32)
+        w->transparent = true;
+
+    uint8_t flags = 0;
+    if(w->isRenderable())
+        flags |= RenderList::Renderable;
+    if(w->visible)
+        flags |= RenderList::OnScreen;
+    /* a moved window might not cover all of its box */
+    if(!w->transparent && !w->transformMoved)
+        flags |= RenderList::Opaque;
+
+    auto box = getDrawnBox(w);
+    rl.flags[i] = flags;
+    rl.bounds[i] = {box.x1, box.y1, box.x2 - box.x1, box.y2 - box.y1};
+    w->renderDirty = false;
+
+    updateGridEntry(w);
+}
+
+void WinStack::updateRenderList() {
+    auto &rl = renderList;
+
+    /* windows removed from the stack might be in
+     * dirtyWindows, so it is not used when rebuilding */
+    if(rl.rebuild) {
+        rl.wins.clear();
+        forEachWindow([&rl] (const FireWindow &w) {
+            w->renderIndex = rl.wins.size();
+            rl.wins.push_back(w.get());
+        });
+
+        rl.bounds.resize(rl.wins.size());
+        rl.flags.resize(rl.wins.size());
+        for(int i = 0; i < int(rl.wins.size()); i++)
+            updateRenderEntry(i);
+
+        FireWin::dirtyWindows.clear();
+        rl.rebuild = false;
         return;
     }
 
-    win->layer = getTargetLayerForWindow(win);
+    for(auto w : FireWin::dirtyWindows)
+        if(w->renderDirty && w->renderIndex >= 0)
+            updateRenderEntry(w->renderIndex);
+    FireWin::dirtyWindows.clear();
+}
+
+void WinStack::updateGrid() {
+    GetTuple(sw, sh, core->getScreenSize());
+    GetTuple(vw, vh, core->getWorksize());
+    GetTuple(vx, vy, core->getWorkspace());
+
+    /* windows keep their cells when only the viewport changes */
+    grid.setOffset(vx * sw, vy * sh);
+    if(grid.covers(0, 0, vw * sw, vh * sh))
+        return;
+
+    grid.reset(0, 0, vw * sw, vh * sh);
+    forEachWindow([this] (const FireWindow &w) {
+            updateGridEntry(w.get());
+        });
+}
+
+void WinStack::updateGridEntry(FireWin *win) {
+    grid.insert(win, getDrawnBox(win));
+}
+
+std::vector<FireWindow> WinStack::getWindowsInRect(const FireBox &box) {
+    updateRenderList();
 
-    layers[win->layer].push_front(win);
+    std::vector<FireWin*> found;
+    grid.query(box, [&found] (FireWin *w) { found.push_back(w); });
+
+    std::sort(found.begin(), found.end(), [] (FireWin *a, FireWin *b) {
+            return a->renderIndex < b->renderIndex;
+        });
+
+    std::vector<FireWindow> ret;
+    for(auto w : found)
+        ret.push_back(w->stackRef);
+    return ret;
+}
+
+bool WinStack::inStack(FireWindow win) {
+    return win && win->stackRef == win;
+}
+
+void WinStack::addWindow(FireWindow win) {
+    if(inStack(win) || (findWindow(win->id) != nullptr &&
+            win->type != WindowTypeDesktop)) {
+        return;
+    }
+
+    auto layer = getTargetLayerForWindow(win);
+    win->stackRef = win;
+    link(win.get(), layer, layers[layer].top);
+    updateLinks(win);
     restackTransients(win);
 
     windows[win->id] = win;
@@ -44,18 +169,13 @@ void WinStack::recalcWindowLayer(FireWindow win) {
     if(win->layer == newLayer)
         return;
 
-    auto it = getIteratorPositionForWindow(win);
-    if(it != layers[win->layer].end())
-        layers[win->layer].erase(it),
-        layers[newLayer].push_front(win);
-    win->layer = newLayer;
-}
+    if(!inStack(win)) {
+        win->layer = newLayer;
+        return;
+    }
 
-StackIterator WinStack::getIteratorPositionForWindow(FireWindow win) {
-    return std::find_if(layers[win->layer].begin(), layers[win->layer].end(),
-            [win] (FireWindow w) {
-                return w && w->id == win->id;
-            });
+    unlink(win.get());
+    link(win.get(), newLayer, layers[newLayer].top);
 }
 
 FireWindow WinStack::findWindow(Window win) {
@@ -65,84 +185,209 @@ FireWindow WinStack::findWindow(Window win) {
     return nullptr;
 }
 
+namespace {
+    /* the transformed box is known only for windows
+     * drawn from their geometry, without effects */
+    bool canCull(FireWin *w) {
+        if(w->disableVBOChange)
+            return false;
+
+        for(auto &e : w->effects)
+            if(e.second->getState())
+                return false;
+        return true;
+    }
+}
+
 void WinStack::renderWindows() {
-    if(FireWin::allDamaged) {
-        XDestroyRegion(core->dmg);
-        core->dmg = copyRegion(output);
+    updateRenderList();
 
-        for(int layer = layers.size() - 1; layer >= 0; layer--) {
-            auto it = layers[layer].rbegin();
-            while(it != layers[layer].rend()) {
-                auto w = *it;
-                if(w && w->shouldBeDrawn())
-                    w->render();
+    auto &rl = renderList;
+    int n = rl.wins.size();
 
-                ++it;
+    if(FireWin::allDamaged) {
+        core->dmg = output;
+        GetTuple(sw, sh, core->getScreenSize());
+
+        for(int i = n - 1; i >= 0; i--) {
+            if(!(rl.flags[i] & RenderList::Renderable))
+                continue;
+
+            /* output may be the whole desktop, but only what
+             * ends up on screen after the transform is seen.
+             * Culled windows don't update their texture */
+            auto w = rl.wins[i];
+            if(canCull(w)) {
+                auto &b = w->getTransformedBox();
+                FireBox vis = {std::max(b.x1, 0), std::max(b.y1, 0),
+                    std::min(b.x2, sw), std::min(b.y2, sh)};
+
+                if(vis.x1 >= vis.x2 || vis.y1 >= vis.y2 ||
+                        !core->dmg.overlaps(vis.x1, vis.y1,
+                            vis.x2 - vis.x1, vis.y2 - vis.y1)) {
+                    ++cullStats.culled;
+                    continue;
+                }
             }
+
+            ++cullStats.drawn;
+            w->render();
         }
 
         return;
     }
 
-    if(!core->dmg)
-        core->dmg = copyRegion(output);
-
-    std::vector<FireWindow> winsToDraw;
-
-    auto tmp = XCreateRegion();
-    for(auto wins : layers) {
-        for(auto w : wins) {
-            if(w && w->shouldBeDrawn()) {
-                if(w->transparent || w->attrib.depth == 32)
-                    w->transparent = true;
-                else
-                    XIntersectRegion(core->dmg, w->region, tmp),
-                        XXorRegion(core->dmg, tmp, core->dmg);
-
-                winsToDraw.push_back(w);
-            }
-        }
+    /* reused between frames so that they are not reallocated */
+    auto &winsToDraw = drawList;
+    winsToDraw.clear();
+
+    /* only windows in the damaged cells of the grid can
+     * be drawn, render list indices are in stacking order */
+    auto &order = drawOrder;
+    order.clear();
+    grid.query(core->dmg, [&order] (FireWin *w) {
+            if(w->renderIndex >= 0)
+                order.push_back(w->renderIndex);
+        });
+    std::sort(order.begin(), order.end());
+
+    const uint8_t drawable = RenderList::Renderable | RenderList::OnScreen;
+    for(int i : order) {
+        if((rl.flags[i] & drawable) != drawable)
+            continue;
+
+        auto &b = rl.bounds[i];
+        if(!core->dmg.overlaps(b.x, b.y, b.w, b.h))
+            continue;
+
+        /* opaque windows hide what is below them */
+        if(rl.flags[i] & RenderList::Opaque)
+            core->dmg.subtract(FireBox{b.x, b.y, b.x + b.w, b.y + b.h});
+
+        winsToDraw.push_back(rl.wins[i]);
     }
 
     auto it = winsToDraw.rbegin();
     while(it != winsToDraw.rend())
         (*it)->render(), ++it;
-
-    XDestroyRegion(tmp);
 }
 
 void WinStack::removeWindow(FireWindow win) {
     if(!win) return;
     removeClient(win);
 
-    auto it = getIteratorPositionForWindow(win);
-    if(it != layers[win->layer].end()) {
-        windows.erase(win->id);
-        layers[win->layer].erase(it);
+    if(inStack(win)) {
+        auto it = windows.find(win->id);
+        if(it != windows.end() && it->second == win)
+            windows.erase(it);
+
+        unlink(win.get());
+        grid.remove(win.get());
+        unregisterLinks(win.get());
+        unregisterDependents(win.get());
+        win->stackRef.reset();
     }
 }
 
+namespace {
+    void eraseFrom(std::vector<FireWin*> &v, FireWin *win) {
+        v.erase(std::remove(v.begin(), v.end(), win), v.end());
+    }
+}
 
-bool WinStack::recurseIsAncestor(FireWindow parent, FireWindow win) {
-    if(parent->id == win->id)
-        return true;
+void WinStack::unregisterLinks(FireWin *win) {
+    if(win->linkedTransient)
+        eraseFrom(win->linkedTransient->dependents, win);
+    if(win->linkedLeader && win->linkedLeader != win->linkedTransient)
+        eraseFrom(win->linkedLeader->dependents, win);
+
+    if(win->inGroup) {
+        auto it = groups.find(win->linkedLeader);
+        if(it != groups.end()) {
+            eraseFrom(it->second, win);
+            if(it->second.empty())
+                groups.erase(it);
+        }
+    }
 
-    bool mask = false;
+    win->linkedTransient = win->linkedLeader = nullptr;
+    win->inGroup = false;
+}
 
-    if(win->transientFor)
-        mask |= recurseIsAncestor(parent, win->transientFor);
+void WinStack::unregisterDependents(FireWin *win) {
+    auto dependents = std::move(win->dependents);
+    win->dependents.clear();
 
-    if(win->leader)
-        mask |= recurseIsAncestor(parent, win->leader);
+    auto it = groups.find(win);
+    if(it != groups.end()) {
+        for(auto w : it->second)
+            w->inGroup = false;
+        groups.erase(it);
+    }
+
+    for(auto d : dependents) {
+        if(d->linkedTransient == win)
+            d->linkedTransient = nullptr;
+        if(d->linkedLeader == win)
+            d->linkedLeader = nullptr;
 
-    return mask;
+        std::unordered_set<FireWin*> visited;
+        updateAncestors(d, visited);
+    }
 }
 
-bool WinStack::isAncestorTo(FireWindow parent, FireWindow win) {
-    if(win->id == parent->id) // a window is not its own ancestor
-        return false;
+void WinStack::updateAncestors(FireWin *win,
+        std::unordered_set<FireWin*> &visited) {
 
-    return recurseIsAncestor(parent, win);
+    /* links might form a cycle */
+    if(!visited.insert(win).second)
+        return;
+
+    win->ancestors.clear();
+    for(auto p : {win->linkedTransient, win->linkedLeader}) {
+        if(!p) continue;
+
+        win->ancestors.insert(p);
+        win->ancestors.insert(p->ancestors.begin(), p->ancestors.end());
+    }
+    win->ancestors.erase(win);
+
+    for(auto d : win->dependents)
+        updateAncestors(d, visited);
+}
+
+void WinStack::updateLinks(FireWindow win) {
+    if(!inStack(win))
+        return;
+
+    unregisterLinks(win.get());
+
+    win->linkedTransient = win->transientFor.get();
+    win->linkedLeader = win->leader.get();
+
+    if(win->linkedTransient)
+        win->linkedTransient->dependents.push_back(win.get());
+    if(win->linkedLeader && win->linkedLeader != win->linkedTransient)
+        win->linkedLeader->dependents.push_back(win.get());
+
+    if(win->type == WindowTypeWidget || win->type == WindowTypeModal)
+        groups[win->linkedLeader].push_back(win.get()),
+        win->inGroup = true;
+
+    std::unordered_set<FireWin*> visited;
+    updateAncestors(win.get(), visited);
+}
+
+void WinStack::collectDescendants(FireWin *win,
+        std::unordered_set<FireWin*> &result) {
+    for(auto d : win->dependents)
+        if(result.insert(d).second)
+            collectDescendants(d, result);
+}
+
+
+bool WinStack::isAncestorTo(FireWindow parent, FireWindow win) {
+    return win->ancestors.find(parent.get()) != win->ancestors.end();
 }
 
 StackType WinStack::getStackType(FireWindow win1, FireWindow win2) {
@@ -197,12 +442,8 @@ void WinStack::restackAbove(FireWindow above, FireWindow below, bool rstTransien
     if(above == nullptr || below == nullptr)
         return;
 
-    auto pos = getIteratorPositionForWindow(below);
-    auto val = getIteratorPositionForWindow(above);
-
-    if(pos == layers[below->layer].end() ||
-       val == layers[above->layer].end())      // we should not touch
-        return;                                // windows we do not own
+    if(!inStack(below) || !inStack(above)) // we should not touch
+        return;                            // windows we do not own
 
     auto type = getStackType(above, below);
     if(type == StackTypeAncestor ||
@@ -210,11 +451,18 @@ void WinStack::restackAbove(FireWindow above, FireWindow below, bool rstTransien
         return;
     }
 
-    if(below->id == activeWin->id)
+    if(activeWin && below->id == activeWin->id)
         activeWin = above;
 
-    layers[above->layer].erase(val);
-    layers[below->layer].insert(pos, above);
+    /* windows stay in their layer, across layers above
+     * goes as close to below as its layer allows */
+    auto layer = above->layer;
+    if(layer == below->layer)
+        unlink(above.get()),
+        link(above.get(), layer, below.get());
+    else if(layer > below->layer && above.get() != layers[layer].top)
+        unlink(above.get()),
+        link(above.get(), layer, layers[layer].top);
 
     if(!isAncestorTo(below, above) && rstTransients) {
         restackTransients(above);
@@ -227,8 +475,9 @@ void WinStack::restackAbove(FireWindow above, FireWindow below, bool rstTransien
 
 /* returns the topmost window that we can restack above */
 FireWindow WinStack::findTopmostStackingWindow(FireWindow win) {
-    for(int layer = win->layer; layer < layers.size(); layer++) {
-        for(auto w : layers[layer]) {
+    for(int layer = win->layer; layer < NumLayers; layer++) {
+        for(auto ptr = layers[layer].top; ptr; ptr = ptr->below) {
+            auto w = ptr->stackRef;
             if(win->id == w->id || win->type == WindowTypeDesktop)
                 return nullptr;
 
@@ -258,12 +507,32 @@ void WinStack::restackTransients(FireWindow win) {
     if(win == nullptr)
         return;
 
+    /* windows which should be above win are its
+     * descendants and the transients in its group */
+    std::unordered_set<FireWin*> transients;
+    collectDescendants(win.get(), transients);
+
+    for(auto key : {win->leader.get(), win.get()}) {
+        auto it = groups.find(key);
+        if(it == groups.end())
+            continue;
+
+        for(auto w : it->second)
+            if(w->stackRef && isTransientInGroup(w->stackRef, win))
+                transients.insert(w);
+    }
+
+    transients.erase(win.get());
+    if(transients.empty())
+        return;
+
+    /* keep their stacking order */
     std::vector<FireWindow> winsToRestack;
-    for(auto w : layers[win->layer])
-        if(isAncestorTo(win, w) || isTransientInGroup(w, win))
-            winsToRestack.push_back(w);
+    for(auto w = layers[win->layer].top; w; w = w->below)
+        if(transients.find(w) != transients.end())
+            winsToRestack.push_back(w->stackRef);
 
-    for(auto w : winsToRestack)
+    for(const auto &w : winsToRestack)
         restackAbove(w, win, false);
 }
 
@@ -275,11 +544,13 @@ void WinStack::focusWindow(FireWindow win) {
         return;
 
     activeWin = win;
+    core->markStateDirty();
 
     if(win->type == WindowTypeWidget) {
         /* ensure we are on the top of all siblings */
-        if(win->id != layers[win->layer].front()->id)
-            restackAbove(win, layers[win->layer].front());
+        auto top = layers[win->layer].top;
+        if(top && top != win.get())
+            restackAbove(win, top->stackRef);
 
         if(win->transientFor)
             win = win->transientFor;
@@ -288,8 +559,9 @@ void WinStack::focusWindow(FireWindow win) {
     }
 
     if(win->type == WindowTypeModal) {
-        if(win->id != layers[win->layer].front()->id)
-            restackAbove(win, layers[win->layer].front());
+        auto top = layers[win->layer].top;
+        if(top && top != win.get())
+            restackAbove(win, top->stackRef);
 
         win->getInputFocus();
 
@@ -307,8 +579,8 @@ void WinStack::focusWindow(FireWindow win) {
      * just focus the window */
     if(!below || below->id == activeWin->id){
         /* ensure visibility */
-        if(layers[activeWin->layer].size() > 1)
-            restackAbove(activeWin, layers[activeWin->layer].front());
+        if(layers[activeWin->layer].size > 1)
+            restackAbove(activeWin, layers[activeWin->layer].top->stackRef);
         activeWin->getInputFocus();
         return;
     }
@@ -326,37 +598,68 @@ void WinStack::focusWindow(FireWindow win) {
 }
 
 FireWindow WinStack::findWindowAtCursorPosition(int x, int y) {
-    for(auto wins : layers) {
-        for(auto w : wins)
-            if(w->attrib.map_state == IsViewable && // desktop and invisible
-               w->type != WindowTypeDesktop      && // windows should be
-               !w->norender                      && // ignored
-               !w->destroyed                     &&
-               w->region                         &&
-               XPointInRegion(w->region, x, y))
-                  return w;
-    }
+    for(auto &w : getWindowsInRect(FireBox{x, y, x + 1, y + 1}))
+        if(w->attrib.map_state == IsViewable && // desktop and invisible
+           w->type != WindowTypeDesktop      && // windows should be
+           !w->norender                      && // ignored
+           !w->destroyed                     &&
+           w->getScreenRegion().contains(x, y))
+            return w;
 
     return nullptr;
 }
 
 FireWindow WinStack::getTopmostToplevel() {
-    for(auto &wins : layers)
-        for(auto w : wins) {
-            if(w->isVisible() && !w->destroyed &&
-                    w->type != WindowTypeWidget    &&
-                    w->type != WindowTypeDesktop   &&
-                    w->type != WindowTypeDock)
-                  return w;
-        }
+    return findWindowIf([] (const FireWindow &w) {
+            return w->isVisible() && !w->destroyed &&
+                   w->type != WindowTypeWidget    &&
+                   w->type != WindowTypeDesktop   &&
+                   w->type != WindowTypeDock;
+        });
+}
 
-    return nullptr;
+void WinStack::saveState(SharedState *state) {
+    int n = 0;
+    forEachWindow([state, &n] (const FireWindow &w) {
+        /* backgrounds have no X window */
+        if(!w->id || w->destroyed || n == MaxSavedWindows)
+            return;
+
+        auto &sw = state->windows[n++];
+        sw.id = w->id;
+        sw.transientFor = w->transientFor ? w->transientFor->id : 0;
+        sw.leader = w->leader ? w->leader->id : 0;
+        sw.type  = w->type;
+        sw.state = w->state;
+        sw.layer = w->layer;
+        sw.vpx = w->vpX, sw.vpy = w->vpY;
+    });
+    state->numWindows = n;
+
+    n = 0;
+    for(auto id : clientList)
+        if(n < MaxSavedWindows)
+            state->clients[n++] = id;
+    state->numClients = n;
+
+    state->activeWin = activeWin ? activeWin->id : 0;
 }
 
-void WinStack::forEachWindow(WindowProc proc) {
-    for(auto wins : layers)
-        for(auto w : wins)
-            proc(w);
+void WinStack::restoreWindows(std::vector<FireWindow> &restored,
+        SharedState *state) {
+
+    auto it = restored.rbegin();
+    while(it != restored.rend()) {
+        auto w = *it++;
+        w->stackRef = w;
+        link(w.get(), w->layer, layers[w->layer].top);
+        windows[w->id] = w;
+    }
+
+    for(int i = 0; i < state->numClients; i++)
+        if(findWindow(state->clients[i]))
+            clientList.insert(state->clients[i]);
+    setNetClientList();
 }
 
 void WinStack::setNetClientList() {
@@ -381,11 +684,13 @@ bool WinStack::isClientWindow(FireWindow win) {
 void WinStack::addClient(FireWindow win) {
     clientList.insert(win->id);
     setNetClientList();
+    core->markStateDirty();
 }
 void WinStack::removeClient(FireWindow win) {
     if(clientList.find(win->id) != clientList.end())
         clientList.erase(win->id);
     setNetClientList();
+    core->markStateDirty();
 }
 
 void WinStack::checkAddClient(FireWindow win) {
@@ -0,0 +1,94 @@
+#include <region.hpp>
+#include <random>
+#include <iostream>
+#include <cassert>
+
+const int Size = 64;
+
+/* boxes are valid and banded, and no two
+ * adjacent bands have the same boxes */
+void checkBanded(const FireRegion &r) {
+    const FireBox *prev = nullptr;
+    const FireBox *band = nullptr, *prevBand = nullptr;
+    int bandSize = 0, prevSize = 0;
+
+    auto endBand = [&] () {
+        if(!prevBand || prevBand->y2 != band->y1 || prevSize != bandSize)
+            return;
+
+        bool same = true;
+        for(int k = 0; k < bandSize; k++)
+            same &= prevBand[k].x1 == band[k].x1 && prevBand[k].x2 == band[k].x2;
+        assert(!same);
+    };
+
+    for(auto &b : r) {
+        assert(b.x1 < b.x2 && b.y1 < b.y2);
+
+        if(prev && prev->y1 == b.y1) {
+            assert(prev->y2 == b.y2 && prev->x2 < b.x1);
+            ++bandSize;
+        } else {
+            if(prev) {
+                assert(prev->y2 <= b.y1);
+                endBand();
+            }
+            prevBand = band, prevSize = bandSize;
+            band = &b, bandSize = 1;
+        }
+        prev = &b;
+    }
+
+    if(prev)
+        endBand();
+}
+
+FireRegion randomRegion(std::mt19937 &rng, int n) {
+    FireRegion r;
+    for(int i = 0; i < n; i++) {
+        int x = rng() % Size, y = rng() % Size;
+        int w = rng() % 16 + 1, h = rng() % 16 + 1;
+        r.unite(FireBox{x, y, std::min(Size, x + w), std::min(Size, y + h)});
+    }
+    return r;
+}
+
+/* the region after simplify() covers what it did
+ * before and is still properly banded */
+void testSimplify() {
+    std::mt19937 rng(1);
+    for(int i = 0; i < 5000; i++) {
+        auto r = randomRegion(rng, rng() % 12 + 2);
+        auto before = r;
+
+        int maxBoxes = rng() % 6 + 1;
+        int merges = r.simplify(maxBoxes, 100);
+        assert(merges >= 0 && (r.size() <= maxBoxes || !merges));
+        checkBanded(r);
+
+        before.subtract(r);
+        assert(before.empty());
+    }
+}
+
+/* merging the two boxes of the middle band makes it
+ * the same as the bands above and below it */
+void testSimplifyCoalesce() {
+    FireRegion r(0, 0, 30, 10);
+    r.unite(FireBox{0, 10, 10, 20});
+    r.unite(FireBox{20, 10, 30, 20});
+    r.unite(FireBox{0, 20, 30, 30});
+    assert(r.size() == 4);
+
+    assert(r.simplify(3, 1) == 1);
+    assert(r.size() == 1);
+
+    auto &e = r.extents();
+    assert(e.x1 == 0 && e.y1 == 0 && e.x2 == 30 && e.y2 == 30);
+}
+
+int main() {
+    testSimplifyCoalesce();
+    testSimplify();
+    std::cout << "region: ok" << std::endl;
+}
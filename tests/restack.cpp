@@ -0,0 +1,128 @@
+#include <list>
+#include <memory>
+#include <vector>
+#include <chrono>
+#include <random>
+#include <iostream>
+#include <algorithm>
+#include <cassert>
+#include <stacklist.hpp>
+
+/* restacking in a layer of 1000 windows, with the std::list
+ * and find_if WinStack used before and with StackList, which
+ * it uses now. Both must end up in the same order */
+
+const int NumWindows = 1000;
+const int NumRestacks = 20000;
+
+struct Win {
+    unsigned long id;
+    Win *above = nullptr, *below = nullptr;
+};
+using WinPtr = std::shared_ptr<Win>;
+
+WinPtr newWin(unsigned long id) {
+    auto w = std::make_shared<Win>();
+    w->id = id;
+    return w;
+}
+
+struct ListStack {
+    std::list<WinPtr> layer; // front is the topmost window
+
+    std::list<WinPtr>::iterator find(WinPtr win) {
+        return std::find_if(layer.begin(), layer.end(),
+                [win] (WinPtr w) { return w && w->id == win->id; });
+    }
+
+    void restackAbove(WinPtr above, WinPtr below) {
+        auto pos = find(below), val = find(above);
+        if(pos == layer.end() || val == layer.end())
+            return;
+
+        layer.erase(val);
+        layer.insert(pos, above);
+    }
+
+    std::vector<unsigned long> order() {
+        std::vector<unsigned long> ret;
+        for(auto w : layer)
+            ret.push_back(w->id);
+        return ret;
+    }
+};
+
+/* restacking as WinStack::restackAbove() does it
+ * for two windows in the same layer */
+void restackAbove(StackList<Win> &layer, Win *above, Win *below) {
+    layer.unlink(above);
+    layer.link(above, below);
+}
+
+/* the order from top to bottom, checking the links both ways */
+std::vector<unsigned long> order(StackList<Win> &layer) {
+    std::vector<unsigned long> ret;
+    Win *prev = nullptr;
+    for(auto w = layer.top; w; prev = w, w = w->below) {
+        assert(w->above == prev);
+        ret.push_back(w->id);
+    }
+
+    assert(layer.bottom == prev && int(ret.size()) == layer.size);
+    return ret;
+}
+
+template<class Proc>
+double measureMs(Proc proc) {
+    auto start = std::chrono::steady_clock::now();
+    proc();
+    std::chrono::duration<double, std::milli> d =
+        std::chrono::steady_clock::now() - start;
+    return d.count();
+}
+
+int main() {
+    std::vector<WinPtr> listWins, wins;
+    ListStack before;
+    StackList<Win> after;
+
+    for(int i = 0; i < NumWindows; i++) {
+        listWins.push_back(newWin(i));
+        wins.push_back(newWin(i));
+
+        before.layer.push_front(listWins[i]);
+        after.link(wins[i].get(), after.top);
+    }
+
+    std::mt19937 rng(42);
+    std::vector<std::pair<int, int>> ops;
+    while(ops.size() < NumRestacks) {
+        int a = rng() % NumWindows, b = rng() % NumWindows;
+        if(a != b)
+            ops.push_back({a, b});
+    }
+
+    double listMs = measureMs([&] () {
+            for(auto &op : ops)
+                before.restackAbove(listWins[op.first], listWins[op.second]);
+        });
+
+    double intrusiveMs = measureMs([&] () {
+            for(auto &op : ops)
+                restackAbove(after, wins[op.first].get(), wins[op.second].get());
+        });
+
+    /* both must end up with the same stacking order */
+    assert(before.order() == order(after));
+
+    /* removing windows, like WinStack::removeWindow() */
+    for(int i = 0; i < NumWindows; i += 10) {
+        before.layer.erase(before.find(listWins[i]));
+        after.unlink(wins[i].get());
+    }
+    assert(before.order() == order(after));
+
+    std::cout << "restack: " << NumRestacks << " restacks of "
+        << NumWindows << " windows, std::list " << listMs
+        << " ms, intrusive " << intrusiveMs << " ms" << std::endl;
+}
@@ -0,0 +1,45 @@
+#include <timer.hpp>
+#include <cassert>
+
+/* a 0 ms timer added right after advance() must not
+ * wait for the wheel to wrap around */
+void testImmediate() {
+    TimerWheel wheel;
+    for(int i = 0; i < 50; i++) {
+        wheel.advance(getTimeMs());
+
+        bool fired = false;
+        auto start = getTimeMs();
+        wheel.add(1, 0, [&fired] () { fired = true; });
+        assert(wheel.nextTimeout() <= 1);
+
+        while(!fired)
+            wheel.advance(getTimeMs());
+        assert(getTimeMs() - start <= 5);
+    }
+}
+
+/* nextTimeout() is the real expiry, also for timers
+ * on the coarser levels */
+void testNextTimeout() {
+    TimerWheel wheel;
+    wheel.advance(getTimeMs());
+
+    wheel.add(1, 1000, [] () {});
+    int timeout = wheel.nextTimeout();
+    assert(timeout >= 990 && timeout <= 1000);
+
+    wheel.add(2, 300, [] () {});
+    timeout = wheel.nextTimeout();
+    assert(timeout >= 290 && timeout <= 300);
+
+    wheel.remove(2);
+    wheel.remove(1);
+    assert(wheel.nextTimeout() == -1);
+}
+
+int main() {
+    testImmediate();
+    testNextTimeout();
+    std::cout << "timer: ok" << std::endl;
+}